@@ -30,6 +30,23 @@ Lemma exn_mode_eqdec : forall x y : exn_mode, {x=y}+{~x=y}.
 
 Proof. decide equality. Qed.
 
+(* index of the SPSRs in a tmap (see Util.v) *)
+Definition exn_mode_index (m : exn_mode) : Z :=
+  match m with
+    | fiq => 0
+    | irq => 1
+    | svc => 2
+    | abt => 3
+    | und => 4
+  end.
+
+Lemma exn_mode_index_inj : forall x y,
+  exn_mode_index x = exn_mode_index y -> x = y.
+
+Proof.
+intros [] [] h; try refl; simpl in h; discriminate h.
+Qed.
+
 Inductive proc_mode : Type := usr | exn (m : exn_mode) | sys.
 
 Definition word_of_proc_mode (m : proc_mode) : word := repr (Zpos
@@ -81,6 +98,39 @@ destruct (Z_eq_dec k k0). subst. rewrite (proof_irr h0 h). auto.
 right. intro p. inversion p. contradiction.
 Qed.
 
+(* index of the registers in a tmap (see Util.v): the number of the
+register times 8, plus the number of the bank *)
+Definition register_index (r : register) : Z :=
+  match r with
+    | R k => 8 * Regnum.intval k
+    | R_svc k _ => 8 * k + 1
+    | R_abt k _ => 8 * k + 2
+    | R_und k _ => 8 * k + 3
+    | R_irq k _ => 8 * k + 4
+    | R_fiq k _ => 8 * k + 5
+  end.
+
+Lemma regnum_intval_inj : forall k k' : regnum,
+  Regnum.intval k = Regnum.intval k' -> k = k'.
+
+Proof.
+intros [k h] [k' h'] e. simpl in e. apply Regnum.mkint_eq. hyp.
+Qed.
+
+Lemma register_index_inj : forall x y,
+  register_index x = register_index y -> x = y.
+
+Proof.
+intros x y e. unfold register_index in e.
+destruct x; destruct y; cbv beta iota in e; try (elimtype False; omega).
+rewrite (regnum_intval_inj k k0). refl. omega.
+assert (k = k0). omega. subst. rewrite (proof_irr h0 h). refl.
+assert (k = k0). omega. subst. rewrite (proof_irr h0 h). refl.
+assert (k = k0). omega. subst. rewrite (proof_irr h0 h). refl.
+assert (k = k0). omega. subst. rewrite (proof_irr h0 h). refl.
+assert (k = k0). omega. subst. rewrite (proof_irr h0 h). refl.
+Qed.
+
 Definition reg_of_exn_mode (m : exn_mode) (k : regnum)
   : register :=
   match m with
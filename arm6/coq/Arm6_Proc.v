@@ -23,23 +23,33 @@ proc_mode_of_word (cpsr s) = Some m -> mode s = m.
 To preserve this invariant, always use the function set_cpsr defined
 hereafter. *)
 
+(* The SPSRs and the registers are stored in tmaps (see Util.v), so
+that reading or writing a register does not depend on the number of
+previous writes in the extracted simulator. *)
+
 Record state : Type := mk_state {
   (* Current program status register *)
   cpsr : word;
   (* Saved program status registers *)
-  spsr : exn_mode -> word;
+  spsrs : tmap exn_mode word;
   (* Registers *)
-  reg : register -> word;
+  regs : tmap register word;
   (* Raised exceptions *)
   exns : list exception;
   (* Processor mode *)
   mode : proc_mode
 }.
 
+Definition spsr (s : state) (o : exn_mode) : word :=
+  tmap_get exn_mode_index (spsrs s) o.
+
+Definition reg (s : state) (r : register) : word :=
+  tmap_get register_index (regs s) r.
+
 Definition set_cpsr (s : state) (w : word) : state :=
   match proc_mode_of_word w with
-    | Some m => mk_state w (spsr s) (reg s) (exns s) m
-    | None => mk_state w (spsr s) (reg s) (exns s) (mode s) (*FIXME?*)
+    | Some m => mk_state w (spsrs s) (regs s) (exns s) m
+    | None => mk_state w (spsrs s) (regs s) (exns s) (mode s) (*FIXME?*)
   end.
 
 Definition set_cpsr_bit (s : state) (n : nat) (w : word) : state :=
@@ -47,8 +57,16 @@ Definition set_cpsr_bit (s : state) (n : nat) (w : word) : state :=
 
 Definition set_spsr (s : state) (o : exn_mode) (w : word) : state :=
   mk_state (cpsr s)
-  (update_map exn_mode_eqdec (spsr s) o w)
-  (reg s) (exns s) (mode s).
+  (tmap_set exn_mode_index (spsrs s) o w)
+  (regs s) (exns s) (mode s).
+
+Lemma spsr_set_spsr : forall s o w o',
+  spsr (set_spsr s o w) o' = update_map exn_mode_eqdec (spsr s) o w o'.
+
+Proof.
+  intros. exact (@tmap_get_set _ _ exn_mode_index exn_mode_index_inj exn_mode_eqdec
+    (spsrs s) o w o').
+Qed.
 
 Definition reg_content_mode (s : state) (m : proc_mode) (k : regnum) : word :=
   reg s (reg_mode m k).
@@ -58,15 +76,24 @@ Definition reg_content (s : state) (k : regnum) : word :=
 
 Definition set_reg_mode (s : state) (m : proc_mode) (k : regnum) (w : word) :
   state :=
-  mk_state (cpsr s) (spsr s)
-  (update_map register_eqdec (reg s) (reg_mode m k) w)
+  mk_state (cpsr s) (spsrs s)
+  (tmap_set register_index (regs s) (reg_mode m k) w)
   (exns s) (mode s).
 
+Lemma reg_set_reg_mode : forall s m k w r,
+  reg (set_reg_mode s m k w) r
+  = update_map register_eqdec (reg s) (reg_mode m k) w r.
+
+Proof.
+  intros. exact (@tmap_get_set _ _ register_index register_index_inj register_eqdec
+    (regs s) (reg_mode m k) w r).
+Qed.
+
 Definition set_reg (s : state) (k : regnum) (w : word) : state :=
   set_reg_mode s (mode s) k w.
 
 Definition set_exns (s : state) (es : list exception) : state :=
-  mk_state (cpsr s) (spsr s) (reg s) es (mode s).
+  mk_state (cpsr s) (spsrs s) (regs s) es (mode s).
 
 Definition add_exn (s : state) (e : exception) : state :=
   set_exns s (insert e (exns s)).
@@ -32,13 +32,27 @@ Definition EEbit := 25%nat.
 (** Coprocessor state *)
 (****************************************************************************)
 
+(* The memory is stored in a tmap (see Util.v), so that reading or
+writing a word does not depend on the number of previous writes in the
+extracted simulator. *)
+
 Record state : Type := mk_state {
   (* registers *)
   reg : regnum -> word;
   (* memory *)
-  mem : address -> word
+  mem : tmap address word
 }.
 
+Definition mem_get (s : state) (a : address) : word :=
+  tmap_get Address.intval (mem s) a.
+
+Lemma address_intval_inj : forall a b : address,
+  Address.intval a = Address.intval b -> a = b.
+
+Proof.
+  intros [a Ha] [b Hb] H. simpl in H. apply Address.mkint_eq. exact H.
+Qed.
+
 Definition CP15_reg1 (s : state) : word := reg s (mk_regnum 1).
 
 Definition high_vectors_configured (s : state) : bool :=
@@ -57,7 +71,7 @@ Definition read_bits (n : size) (a w : word) :=
   end.
 
 Definition read (s : state) (a : word) (n : size) : word :=
-  read_bits n a (mem s (address_of_word a)).
+  read_bits n a (mem_get s (address_of_word a)).
 
 (* a: address; v: new value; v: old value *)
 Definition write_bits (n : size) (a v w : word) :=
@@ -69,5 +83,21 @@ Definition write_bits (n : size) (a v w : word) :=
 
 Definition write (s : state) (a : word) (n : size) (v : word) : state :=
   let aa := address_of_word a in
-  mk_state (reg s)
-  (update_map Address.eq_dec (mem s) aa (write_bits n a v (mem s aa))).
+  mk_state (reg s) (tmap_set Address.intval (mem s) aa (write_bits n a v (mem_get s aa))).
+
+Lemma read_write_same : forall s a v, read (write s a Word v) a Word = v.
+
+Proof.
+  intros. exact (@tmap_get_set_same _ _ Address.intval (mem s) (address_of_word a) v).
+Qed.
+
+Lemma read_write_other : forall s a b n m v,
+  address_of_word a <> address_of_word b ->
+  read (write s a n v) b m = read s b m.
+
+Proof.
+  intros. unfold read, mem_get.
+  change (mem (write s a n v)) with (tmap_set Address.intval (mem s) (address_of_word a)
+    (write_bits n a v (mem_get s (address_of_word a)))).
+  rewrite (@tmap_get_set_other _ _ Address.intval address_intval_inj). reflexivity. exact H.
+Qed.
@@ -62,10 +62,11 @@ int main(int argc, const char *argv[]) {
     "Definition initial_scc_reg (r : regnum) : word := w0.\n"
     "\n"
     "Definition proc_initial_state : Arm6_Proc.state :=\n"
-    "  Arm6_Proc.mk_state initial_cpsr initial_spsr initial_reg nil sys.\n"
+    "  Arm6_Proc.mk_state initial_cpsr (tmap_of_fun initial_spsr)\n"
+    "    (tmap_of_fun initial_reg) nil sys.\n"
     "\n"
     "Definition scc_initial_state : Arm6_SCC.state :=\n"
-    "  Arm6_SCC.mk_state initial_scc_reg initial_mem.\n"
+    "  Arm6_SCC.mk_state initial_scc_reg (tmap_of_fun initial_mem).\n"
     "\n"
     "Definition initial_state : state :=\n"
     "  mk_state proc_initial_state scc_initial_state.\n";
@@ -0,0 +1,184 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* A minimal set of memory-mapped devices */
+
+#include "arm_devices.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+/* interrupt controller */
+
+/* propagate the state of the controller to the processor */
+static void intc_update(struct SLv6_InterruptController *intc) {
+  slv6_set_interrupt_inputs(intc->proc,slv6_irq_pending(intc),slv6_fiq_pending(intc));
+}
+
+static uint32_t intc_read(struct SLv6_Device *dev, uint32_t offset, uint8_t size) {
+  struct SLv6_InterruptController *intc = (struct SLv6_InterruptController*) dev;
+  const uint32_t lines = intc->raw|intc->soft;
+  switch (offset) {
+  case 0x00: return lines&intc->enable&~intc->select; /* IRQSTATUS */
+  case 0x04: return lines&intc->enable&intc->select; /* FIQSTATUS */
+  case 0x08: return lines; /* RAWINTR */
+  case 0x0c: return intc->select; /* INTSELECT */
+  case 0x10: return intc->enable; /* INTENABLE */
+  case 0x18: return intc->soft; /* SOFTINT */
+  default: return 0;
+  }
+}
+
+static void intc_write(struct SLv6_Device *dev, uint32_t offset, uint8_t size,
+                       uint32_t data) {
+  struct SLv6_InterruptController *intc = (struct SLv6_InterruptController*) dev;
+  switch (offset) {
+  case 0x0c: intc->select = data; break; /* INTSELECT */
+  case 0x10: intc->enable |= data; break; /* INTENABLE */
+  case 0x14: intc->enable &= ~data; break; /* INTENCLEAR */
+  case 0x18: intc->soft |= data; break; /* SOFTINT */
+  case 0x1c: intc->soft &= ~data; break; /* SOFTINTCLEAR */
+  default: break;
+  }
+  intc_update(intc);
+}
+
+void slv6_set_interrupt_line(struct SLv6_InterruptController *intc,
+                             uint8_t line, bool level) {
+  assert(line<32);
+  if (level)
+    intc->raw |= 1u<<line;
+  else
+    intc->raw &= ~(1u<<line);
+  intc_update(intc);
+}
+
+/* timer */
+
+#define TIMER_ONESHOT 0x01
+#define TIMER_INT_ENABLE 0x20
+#define TIMER_PERIODIC 0x40
+#define TIMER_ENABLE 0x80
+
+static void timer_update_line(struct SLv6_Timer *timer) {
+  slv6_set_interrupt_line(timer->intc,SLV6_TIMER_IRQ,
+                          timer->raw && (timer->control&TIMER_INT_ENABLE));
+}
+
+static uint32_t timer_read(struct SLv6_Device *dev, uint32_t offset, uint8_t size) {
+  struct SLv6_Timer *timer = (struct SLv6_Timer*) dev;
+  switch (offset) {
+  case 0x00: return timer->load; /* Load */
+  case 0x04: return timer->value; /* Value */
+  case 0x08: return timer->control; /* Control */
+  case 0x10: return timer->raw; /* RIS */
+  case 0x14: return timer->raw && (timer->control&TIMER_INT_ENABLE); /* MIS */
+  case 0x18: return timer->load; /* BGLoad */
+  default: return 0;
+  }
+}
+
+static void timer_write(struct SLv6_Device *dev, uint32_t offset, uint8_t size,
+                        uint32_t data) {
+  struct SLv6_Timer *timer = (struct SLv6_Timer*) dev;
+  switch (offset) {
+  case 0x00: timer->load = timer->value = data; break; /* Load */
+  case 0x08: timer->control = data; break; /* Control */
+  case 0x0c: timer->raw = false; break; /* IntClr */
+  case 0x18: timer->load = data; break; /* BGLoad */
+  default: break;
+  }
+  timer_update_line(timer);
+}
+
+static void timer_advance(struct SLv6_Device *dev, uint32_t n) {
+  struct SLv6_Timer *timer = (struct SLv6_Timer*) dev;
+  if (!(timer->control&TIMER_ENABLE))
+    return;
+  while (n>=timer->value) {
+    /* the counter reaches 0 */
+    n -= timer->value;
+    timer->raw = true;
+    if (timer->control&TIMER_ONESHOT) {
+      timer->control &= ~TIMER_ENABLE;
+      timer->value = 0;
+    } else
+      timer->value = timer->control&TIMER_PERIODIC ? timer->load : 0xffffffff;
+    if (timer->value==0) {
+      n = 0;
+      break;
+    }
+  }
+  timer->value -= n;
+  timer_update_line(timer);
+}
+
+/* the timer will reach 0 again, and its interrupt is not masked */
+static bool timer_may_interrupt(struct SLv6_Device *dev) {
+  const struct SLv6_Timer *timer = (const struct SLv6_Timer*) dev;
+  const struct SLv6_InterruptController *intc = timer->intc;
+  const uint32_t line = 1u<<SLV6_TIMER_IRQ;
+  if (!(timer->control&TIMER_ENABLE) || !(timer->control&TIMER_INT_ENABLE) ||
+      !(intc->enable&line))
+    return false;
+  if (intc->select&line)
+    return !intc->proc->cpsr.F_flag;
+  return !intc->proc->cpsr.I_flag;
+}
+
+/* console */
+
+static uint32_t console_read(struct SLv6_Device *dev, uint32_t offset, uint8_t size) {
+  switch (offset) {
+  case 0x18: return 0x90; /* FR: transmit FIFO and receive FIFO empty */
+  default: return 0;
+  }
+}
+
+static void console_write(struct SLv6_Device *dev, uint32_t offset, uint8_t size,
+                          uint32_t data) {
+  struct SLv6_Console *console = (struct SLv6_Console*) dev;
+  if (offset==0x00) { /* DR */
+    fputc(data&0xff,console->out);
+    fflush(console->out);
+  }
+}
+
+/* platform */
+
+static void init_Device(struct SLv6_Device *dev, const char *name, uint32_t begin,
+                        uint32_t (*read)(struct SLv6_Device*, uint32_t, uint8_t),
+                        void (*write)(struct SLv6_Device*, uint32_t, uint8_t, uint32_t),
+                        void (*advance)(struct SLv6_Device*, uint32_t),
+                        bool (*may_interrupt)(struct SLv6_Device*)) {
+  dev->name = name;
+  dev->begin = begin;
+  dev->size = SLV6_MEM_PAGE_SIZE;
+  dev->read = read;
+  dev->write = write;
+  dev->advance = advance;
+  dev->may_interrupt = may_interrupt;
+  dev->next = NULL;
+}
+
+void init_Devices(struct SLv6_Devices *devs, struct SLv6_Processor *proc) {
+  SLv6_MMU *mmu = proc->mmu_ptr;
+  init_Device(&devs->intc.dev,"intc",SLV6_INTC_BASE,intc_read,intc_write,NULL,
+              NULL);
+  devs->intc.raw = devs->intc.soft = devs->intc.enable = devs->intc.select = 0;
+  devs->intc.proc = proc;
+  init_Device(&devs->timer.dev,"timer",SLV6_TIMER_BASE,timer_read,timer_write,
+              timer_advance,timer_may_interrupt);
+  devs->timer.load = 0;
+  devs->timer.value = 0xffffffff;
+  devs->timer.control = TIMER_INT_ENABLE; /* reset value */
+  devs->timer.raw = false;
+  devs->timer.intc = &devs->intc;
+  init_Device(&devs->console.dev,"console",SLV6_CONSOLE_BASE,console_read,
+              console_write,NULL,NULL);
+  devs->console.out = stdout;
+  slv6_add_device(mmu,&devs->intc.dev);
+  slv6_add_device(mmu,&devs->timer.dev);
+  slv6_add_device(mmu,&devs->console.dev);
+}
+
+END_SIMSOC_NAMESPACE
@@ -0,0 +1,79 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* A minimal set of memory-mapped devices */
+
+/* The devices are mapped at the addresses used by the ARM Versatile
+ * platform, and implement a small subset of the corresponding ARM
+ * PrimeCells:
+ * - an interrupt controller (PL190 VIC): registers IRQSTATUS, FIQSTATUS,
+ *   RAWINTR, INTSELECT, INTENABLE, INTENCLEAR, SOFTINT and SOFTINTCLEAR.
+ *   Its outputs drive the IRQ and FIQ inputs of the processor;
+ * - a timer (first timer of a SP804), connected to the interrupt line 4.
+ *   It is decremented once per executed instruction;
+ * - a console (PL011 UART): the characters written to the data register
+ *   are printed on stdout, and nothing can be received. */
+
+#ifndef ARM_DEVICES_H
+#define ARM_DEVICES_H
+
+#include "common.h"
+#include "arm_mmu.h"
+#include "slv6_processor.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+#define SLV6_INTC_BASE 0x10140000
+#define SLV6_TIMER_BASE 0x101e2000
+#define SLV6_CONSOLE_BASE 0x101f1000
+
+#define SLV6_TIMER_IRQ 4
+
+struct SLv6_InterruptController {
+  struct SLv6_Device dev;
+  uint32_t raw; /* lines raised by the devices */
+  uint32_t soft; /* lines raised by software */
+  uint32_t enable;
+  uint32_t select; /* 1 for FIQ, 0 for IRQ */
+  struct SLv6_Processor *proc; /* processor receiving the interrupts */
+};
+
+struct SLv6_Timer {
+  struct SLv6_Device dev;
+  uint32_t load;
+  uint32_t value;
+  uint32_t control;
+  bool raw; /* raw interrupt status */
+  struct SLv6_InterruptController *intc;
+};
+
+struct SLv6_Console {
+  struct SLv6_Device dev;
+  FILE *out;
+};
+
+struct SLv6_Devices {
+  struct SLv6_InterruptController intc;
+  struct SLv6_Timer timer;
+  struct SLv6_Console console;
+};
+
+/* initialize the devices, map them in the MMU of proc, and connect the
+ * interrupt controller to proc */
+extern void init_Devices(struct SLv6_Devices*, struct SLv6_Processor *proc);
+
+/* set the level of an interrupt line */
+extern void slv6_set_interrupt_line(struct SLv6_InterruptController*,
+                                    uint8_t line, bool level);
+
+static inline bool slv6_irq_pending(const struct SLv6_InterruptController *intc) {
+  return ((intc->raw|intc->soft)&intc->enable&~intc->select)!=0;
+}
+
+static inline bool slv6_fiq_pending(const struct SLv6_InterruptController *intc) {
+  return ((intc->raw|intc->soft)&intc->enable&intc->select)!=0;
+}
+
+END_SIMSOC_NAMESPACE
+
+#endif /* ARM_DEVICES_H */
@@ -4,78 +4,296 @@
 /* Interface between the ISS and the memory(/MMU) */
 
 #include "arm_mmu.h"
+#include "slv6_decode_cache.h"
+#include "slv6_basic_block.h"
+#include "slv6_trace.h"
 #include <string.h>
 #include <assert.h>
+#include <sys/mman.h>
 
-void init_MMU(SLv6_MMU *mmu, uint32_t begin, uint32_t size) {
-  assert((begin&3)==0 && "memory start not aligned on a word boundary");
-  assert((size&3)==0 && "memory size not aligned on a word boundary");
-  mmu->begin = begin;
-  mmu->size = size;
-  mmu->end = begin+size;
-  mmu->mem = (uint8_t*) calloc(size,1);
+static void init_caches(SLv6_MMU *mmu) {
+  uint32_t i;
+  for (i = 0; i<SLV6_MEM_CACHE_SIZE; ++i) {
+    mmu->cache[i].page = mmu->wcache[i].page = ~0u;
+    mmu->cache[i].mem = mmu->wcache[i].mem = NULL;
+  }
+}
+
+void init_MMU(SLv6_MMU *mmu) {
+  mmu->pages = (uint8_t**) calloc(SLV6_MEM_PAGE_COUNT,sizeof(uint8_t*));
+  init_caches(mmu);
+  mmu->io_pages = NULL;
+  mmu->devices = NULL;
+  mmu->page_count = 0;
+  mmu->dc = NULL;
+  mmu->bc = NULL;
+  mmu->owner = true;
+  mmu->monitor = NULL;
+  mmu->core_id = 0;
+  mmu->next_core = mmu;
+  memset(mmu->code_writes,0,sizeof(mmu->code_writes));
+  mmu->code_write_count = 0;
+  mmu->mapped = NULL;
+  mmu->mapped_size = 0;
+  mmu->trace = NULL;
+}
+
+void init_shared_MMU(SLv6_MMU *mmu, SLv6_MMU *main,
+                     struct SLv6_ExclusiveMonitor *monitor, uint32_t core_id) {
+  mmu->pages = main->pages;
+  init_caches(mmu);
+  mmu->io_pages = main->io_pages;
+  mmu->devices = main->devices;
+  mmu->page_count = 0;
+  mmu->dc = NULL;
+  mmu->bc = NULL;
+  mmu->owner = false;
+  mmu->monitor = monitor;
+  mmu->core_id = core_id;
+  mmu->next_core = main->next_core;
+  main->next_core = mmu;
+  memset(mmu->code_writes,0,sizeof(mmu->code_writes));
+  mmu->code_write_count = 0;
+  mmu->mapped = NULL;
+  mmu->mapped_size = 0;
+  mmu->trace = NULL;
 }
 
 void destruct_MMU(SLv6_MMU *mmu) {
-  free(mmu->mem);
+  uint32_t i;
+  if (!mmu->owner)
+    return;
+  for (i = 0; i<SLV6_MEM_PAGE_COUNT; ++i) {
+    uint8_t *p = mmu->pages[i];
+    if (!mmu->mapped || p<mmu->mapped || p>=mmu->mapped+mmu->mapped_size)
+      free(p);
+  }
+  free(mmu->pages);
+  free(mmu->io_pages);
+  if (mmu->mapped)
+    munmap(mmu->mapped,mmu->mapped_size);
+}
+
+void slv6_add_device(SLv6_MMU *mmu, struct SLv6_Device *dev) {
+  uint32_t page = dev->begin>>SLV6_MEM_PAGE_BITS;
+  const uint32_t end = page+(dev->size>>SLV6_MEM_PAGE_BITS);
+  uint32_t i;
+  assert(SLV6_MEM_OFFSET(dev->begin)==0 && SLV6_MEM_OFFSET(dev->size)==0 &&
+         dev->size!=0 && "device not aligned on pages");
+  if (!mmu->io_pages)
+    mmu->io_pages = (struct SLv6_Device**)
+      calloc(SLV6_MEM_PAGE_COUNT,sizeof(struct SLv6_Device*));
+  for (; page!=end; ++page) {
+    assert(!mmu->io_pages[page] && "two devices at the same address");
+    mmu->io_pages[page] = dev;
+  }
+  /* the pages of the device may be in the caches */
+  for (i = 0; i<SLV6_MEM_CACHE_SIZE; ++i)
+    mmu->cache[i].page = mmu->wcache[i].page = ~0u;
+  dev->next = mmu->devices;
+  mmu->devices = dev;
+}
+
+void slv6_advance_devices_aux(SLv6_MMU *mmu, uint32_t n) {
+  struct SLv6_Device *dev = mmu->devices;
+  for (; dev; dev = dev->next)
+    if (dev->advance)
+      dev->advance(dev,n);
+}
+
+bool slv6_may_interrupt_aux(SLv6_MMU *mmu) {
+  struct SLv6_Device *dev = mmu->devices;
+  for (; dev; dev = dev->next)
+    if (dev->may_interrupt && dev->may_interrupt(dev))
+      return true;
+  return false;
+}
+
+static uint32_t io_read(SLv6_MMU *mmu, uint32_t addr, uint8_t size) {
+  struct SLv6_Device *dev = mmu->io_pages[addr>>SLV6_MEM_PAGE_BITS];
+  const uint32_t data = dev->read(dev,addr-dev->begin,size);
+  DEBUG(printf("read %x from device %s at %x\n",data,dev->name,addr));
+  return data;
+}
+
+static void io_write(SLv6_MMU *mmu, uint32_t addr, uint8_t size, uint32_t data) {
+  struct SLv6_Device *dev = mmu->io_pages[addr>>SLV6_MEM_PAGE_BITS];
+  DEBUG(printf("write %x to device %s at %x\n",data,dev->name,addr));
+  dev->write(dev,addr-dev->begin,size,data);
+}
+
+uint8_t *slv6_mem_lookup(SLv6_MMU *mmu, uint32_t addr) {
+  const uint32_t page = addr>>SLV6_MEM_PAGE_BITS;
+  struct SLv6_MemCacheEntry *e = &mmu->cache[page&(SLV6_MEM_CACHE_SIZE-1)];
+  uint8_t **p = &mmu->pages[page];
+  uint8_t *mem;
+  if (mmu->io_pages && mmu->io_pages[page])
+    return NULL;
+  mem = SLV6_ATOMIC_LOAD(p,ACQUIRE);
+  if (!mem) {
+    uint8_t *expected = NULL;
+    DEBUG(printf("allocate memory page %x\n",page<<SLV6_MEM_PAGE_BITS));
+    mem = (uint8_t*) calloc(SLV6_MEM_PAGE_SIZE,1);
+    /* another core may have allocated the page in the meantime */
+    if (SLV6_ATOMIC_CAS(p,&expected,mem))
+      ++mmu->page_count;
+    else {
+      free(mem);
+      mem = expected;
+    }
+  }
+  e->page = page;
+  e->mem = mem;
+  return mem+SLV6_MEM_OFFSET(addr);
+}
+
+/* code_page and invalidate_code index the pages of the decode
+ * caches by memory page numbers */
+#if SLV6_DC_PAGE_BITS!=SLV6_MEM_PAGE_BITS
+#error "the pages of the decode cache and of the memory must have the same size"
+#endif
+
+/* tell if a core has decoded instructions in the page */
+static bool code_page(SLv6_MMU *mmu, uint32_t page) {
+  SLv6_MMU *m = mmu;
+  do {
+    if (m->dc && SLV6_ATOMIC_LOAD(&m->dc->pages[page],SEQ_CST))
+      return true;
+  } while ((m = m->next_core)!=mmu);
+  return false;
+}
+
+/* called after a write at address addr: the next writes to this page may
+ * use the fast path, if no core has decoded an instruction of this page */
+static void cache_for_write(SLv6_MMU *mmu, uint32_t addr) {
+  const uint32_t page = addr>>SLV6_MEM_PAGE_BITS;
+  if (!mmu->trace && !code_page(mmu,page)) {
+    struct SLv6_MemCacheEntry *e = &mmu->wcache[page&(SLV6_MEM_CACHE_SIZE-1)];
+    e->mem = mmu->pages[page];
+    SLV6_ATOMIC_STORE(&e->page,page,SEQ_CST);
+    /* another core may have decoded an instruction of this page in the
+     * meantime, before evicting the entry (see slv6_mem_code_page) */
+    if (mmu->next_core!=mmu && code_page(mmu,page))
+      SLV6_ATOMIC_STORE(&e->page,~0u,SEQ_CST);
+  }
+}
+
+/* post the word at address addr to the queue of code writes of another
+ * core. As on a real multi-core, this core may still execute the old
+ * instruction until it drains its queue. */
+static void post_code_write(SLv6_MMU *m, uint32_t addr) {
+  const uint32_t i = SLV6_ATOMIC_FETCH_ADD(&m->code_write_count,1);
+  if (i<SLV6_CODE_WRITE_QUEUE_SIZE)
+    SLV6_ATOMIC_STORE(&m->code_writes[i],(addr&~3u)+1,RELEASE);
+}
+
+void slv6_drain_code_writes_aux(SLv6_MMU *mmu) {
+  uint32_t done = 0, n, i, w;
+  do {
+    n = SLV6_ATOMIC_LOAD(&mmu->code_write_count,ACQUIRE);
+    for (i = done; i<n && i<SLV6_CODE_WRITE_QUEUE_SIZE; ++i) {
+      /* the core which has reserved the entry may not have written it yet */
+      while (!(w = SLV6_ATOMIC_LOAD(&mmu->code_writes[i],ACQUIRE)));
+      SLV6_ATOMIC_STORE(&mmu->code_writes[i],0,RELAXED);
+      slv6_dc_invalidate(mmu->dc,w-1,4);
+      if (mmu->bc) slv6_bc_invalidate(mmu->bc,w-1);
+    }
+    if (n>SLV6_CODE_WRITE_QUEUE_SIZE) {
+      slv6_dc_clear(mmu->dc);
+      if (mmu->bc) mmu->bc->flush_pending = true;
+    }
+    done = n;
+    /* other writes may have been posted in the meantime */
+  } while (!SLV6_ATOMIC_CAS(&mmu->code_write_count,&n,0));
+}
+
+/* called after a write of size bytes at address addr */
+static void invalidate_code(SLv6_MMU *mmu, uint32_t addr, uint32_t size) {
+  const uint32_t page = addr>>SLV6_MEM_PAGE_BITS;
+  SLv6_MMU *m;
+  if (mmu->dc) slv6_dc_invalidate(mmu->dc,addr,size);
+  if (mmu->bc) slv6_bc_invalidate(mmu->bc,addr);
+  if (mmu->next_core==mmu)
+    return;
+  /* the write must be visible to a core which allocates the page of its
+   * decode cache after this test (see get_page in slv6_decode_cache.c) */
+  SLV6_ATOMIC_FENCE();
+  for (m = mmu->next_core; m!=mmu; m = m->next_core)
+    if (m->dc && SLV6_ATOMIC_LOAD(&m->dc->pages[page],SEQ_CST))
+      post_code_write(m,addr);
 }
 
 uint8_t slv6_read_byte(SLv6_MMU *mmu, uint32_t addr) {
-  assert(mmu->begin<=addr && addr<mmu->end && "out of memory access");
-  DEBUG(printf("read byte %x from %x\n",(uint32_t)mmu->mem[addr-mmu->begin],addr));
-  return mmu->mem[addr-mmu->begin];
+  const uint8_t *p = slv6_mem_ptr(mmu,addr);
+  if (!p) return io_read(mmu,addr,1);
+  DEBUG(printf("read byte %x from %x\n",(uint32_t)*p,addr));
+  return *p;
 }
 
 uint16_t slv6_read_half(SLv6_MMU *mmu, uint32_t addr) {
-  assert(mmu->begin<=addr && addr<mmu->end && "out of memory access");
   assert((addr&1)==0 && "misaligned acces");
+  const uint8_t *p = slv6_mem_ptr(mmu,addr);
+  if (!p) return io_read(mmu,addr,2);
   union {
     uint16_t half;
     uint8_t bytes[2];
   } tmp;
-  memcpy(tmp.bytes,mmu->mem+(addr-mmu->begin),2);
+  memcpy(tmp.bytes,p,2);
   DEBUG(printf("read half %x from %x\n",tmp.half,addr));
   return tmp.half;
 }
 
 uint32_t slv6_read_word(SLv6_MMU *mmu, uint32_t addr) {
-  assert(mmu->begin<=addr && addr<mmu->end && "out of memory access");
   assert((addr&3)==0 && "misaligned acces");
+  const uint8_t *p = slv6_mem_ptr(mmu,addr);
+  if (!p) return io_read(mmu,addr,4);
   union {
     uint32_t word;
     uint8_t bytes[4];
   } tmp;
-  memcpy(tmp.bytes,mmu->mem+(addr-mmu->begin),4);
+  memcpy(tmp.bytes,p,4);
   DEBUG(printf("read %x from %x\n",tmp.word,addr));
   return tmp.word;
 }
 
 void slv6_write_byte(SLv6_MMU *mmu, uint32_t addr, uint8_t data) {
-  assert(mmu->begin<=addr && addr<mmu->end && "out of memory access");
-  mmu->mem[addr-mmu->begin] = data;
+  uint8_t *p = slv6_mem_ptr(mmu,addr);
+  if (mmu->trace) slv6_trace_mem(mmu->trace,addr,1,data);
+  if (!p) {io_write(mmu,addr,1,data); return;}
+  *p = data;
+  invalidate_code(mmu,addr,1);
+  cache_for_write(mmu,addr);
   DEBUG(printf("write byte %x to %x\n",(uint32_t) data,addr));
 }
 
 void slv6_write_half(SLv6_MMU *mmu, uint32_t addr, uint16_t data) {
-  assert(mmu->begin<=addr && addr<mmu->end && "out of memory access");
   assert((addr&1)==0 && "misaligned acces");
+  uint8_t *p = slv6_mem_ptr(mmu,addr);
+  if (mmu->trace) slv6_trace_mem(mmu->trace,addr,2,data);
+  if (!p) {io_write(mmu,addr,2,data); return;}
   union {
     uint16_t half;
     uint8_t bytes[2];
   } tmp;
   tmp.half = data;
-  memcpy(mmu->mem+(addr-mmu->begin),tmp.bytes,2);
+  memcpy(p,tmp.bytes,2);
+  invalidate_code(mmu,addr,2);
+  cache_for_write(mmu,addr);
   DEBUG(printf("write half %x to %x\n",tmp.half,addr));
 }
 
 void slv6_write_word(SLv6_MMU *mmu, uint32_t addr, uint32_t data) {
-  assert(mmu->begin<=addr && addr<mmu->end && "out of memory access");
   assert((addr&3)==0 && "misaligned acces");
+  uint8_t *p = slv6_mem_ptr(mmu,addr);
+  if (mmu->trace) slv6_trace_mem(mmu->trace,addr,4,data);
+  if (!p) {io_write(mmu,addr,4,data); return;}
   union {
     uint32_t word;
     uint8_t bytes[4];
   } tmp;
   tmp.word = data;
-  memcpy(mmu->mem+(addr-mmu->begin),tmp.bytes,4);
+  memcpy(p,tmp.bytes,4);
+  invalidate_code(mmu,addr,4);
+  cache_for_write(mmu,addr);
   DEBUG(printf("write %x to %x\n",tmp.word,addr));
 }
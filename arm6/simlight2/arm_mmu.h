@@ -3,22 +3,154 @@
 
 /* Interface between the ISS and the memory(/MMU) */
 
+/* The memory covers the whole 32-bit address space. It is split into
+ * pages of SLV6_MEM_PAGE_SIZE bytes, which are allocated (and filled
+ * with 0) the first time they are accessed. The host addresses of the
+ * last used pages are kept in a small direct-mapped cache, so that most
+ * accesses do not read the page table.
+ *
+ * The inline accessors slv6_fast_* are used by the semantics functions
+ * if the ISS is generated with the simgen option -fast-mem. They access
+ * directly the pages found in the caches, and call the out-of-line
+ * accessors otherwise. A page is put in the write cache only if it
+ * contains no decoded instruction, so that a fast write does not need to
+ * invalidate the decode cache (see slv6_mem_code_page).
+ *
+ * Devices can be mapped on some pages (see slv6_add_device). These pages
+ * are never put in the caches, so the accesses to the devices always use
+ * the slow path, and the accesses to the RAM are not slowed down.
+ *
+ * In a multi-core simulation (see slv6_smp.h), each core has its own
+ * SLv6_MMU, which shares the pages and the devices of the MMU of the
+ * first core (see init_shared_MMU), but has its own caches. The pages
+ * are allocated with an atomic operation, so that two cores cannot
+ * allocate the same page. The MMUs of the cores are linked in a ring
+ * (next_core), so that a page is put in the write cache of a core only if
+ * no core has decoded an instruction of this page. The decode cache and
+ * the block cache of a core are only accessed by its own thread: a write
+ * to a page decoded by another core is posted to the queue of code
+ * writes of this core, which invalidates the modified instructions
+ * between two instructions or two blocks (see slv6_drain_code_writes).
+ *
+ * The pages restored from a checkpoint are not allocated one by one, but
+ * mapped from the checkpoint file (see slv6_checkpoint.h).
+ *
+ * When the execution is traced (see slv6_trace.h), the writes are
+ * recorded by the out-of-line accessors, and the cache of last written
+ * pages is not used. */
+
 #ifndef ARM_MMU_H
 #define ARM_MMU_H
 
 #include "common.h"
+#include <string.h>
+
+struct SLv6_DecodeCache;
+struct SLv6_BlockCache;
+struct SLv6_ExclusiveMonitor;
+struct SLv6_TraceBuffer;
+
+#define SLV6_MEM_PAGE_BITS 12
+#define SLV6_MEM_PAGE_SIZE (1u<<SLV6_MEM_PAGE_BITS)
+#define SLV6_MEM_PAGE_COUNT (1u<<(32-SLV6_MEM_PAGE_BITS))
+#define SLV6_MEM_OFFSET(addr) ((addr)&(SLV6_MEM_PAGE_SIZE-1))
+
+#define SLV6_MEM_CACHE_SIZE 8 /* must be a power of 2 */
+
+#define SLV6_CODE_WRITE_QUEUE_SIZE 64
+
+struct SLv6_MemCacheEntry {
+  uint32_t page; /* page number, or ~0 if the entry is empty */
+  uint8_t *mem; /* host address of the page */
+};
 
-typedef struct {
+/* A memory-mapped device covers the pages [begin, begin+size). The
+ * offset given to read and write is relative to begin, and the size of
+ * the access is 1, 2, or 4 bytes. */
+struct SLv6_Device {
+  const char *name;
   uint32_t begin;
   uint32_t size;
-  uint32_t end;
-  uint8_t *mem;
+  uint32_t (*read)(struct SLv6_Device*, uint32_t offset, uint8_t size);
+  void (*write)(struct SLv6_Device*, uint32_t offset, uint8_t size, uint32_t data);
+  /* called after the execution of n instructions; may be NULL */
+  void (*advance)(struct SLv6_Device*, uint32_t n);
+  /* tell if the device may raise later an interrupt which is not masked
+   * (by the interrupt controller or the CPSR); may be NULL if the device
+   * never raises an interrupt by itself */
+  bool (*may_interrupt)(struct SLv6_Device*);
+  struct SLv6_Device *next; /* list of all devices */
+};
+
+typedef struct SLv6_MMU {
+  uint8_t **pages; /* SLV6_MEM_PAGE_COUNT pointers */
+  struct SLv6_Device **io_pages; /* idem, NULL if there is no device */
+  struct SLv6_Device *devices;
+  struct SLv6_MemCacheEntry cache[SLV6_MEM_CACHE_SIZE]; /* last used pages */
+  struct SLv6_MemCacheEntry wcache[SLV6_MEM_CACHE_SIZE]; /* last written pages */
+  uint32_t page_count; /* number of allocated pages */
   bool user_mode;
+  struct SLv6_DecodeCache *dc; /* invalidated on write, if not NULL */
+  struct SLv6_BlockCache *bc; /* idem */
+  bool owner; /* false if the pages belong to the MMU of another core */
+  struct SLv6_ExclusiveMonitor *monitor; /* NULL if there is only one core */
+  uint32_t core_id; /* index of the core using this MMU */
+  struct SLv6_MMU *next_core; /* MMU of the next core, itself if one core */
+  /* words written by the other cores, which must be invalidated in the
+   * caches of this core: address+1, or 0 if the entry is not written yet */
+  uint32_t code_writes[SLV6_CODE_WRITE_QUEUE_SIZE];
+  uint32_t code_write_count; /* reserved entries, may exceed the size */
+  uint8_t *mapped; /* pages mapped from a checkpoint, or NULL */
+  size_t mapped_size;
+  struct SLv6_TraceBuffer *trace; /* records the writes, if not NULL */
 } SLv6_MMU;
 
-extern void init_MMU(SLv6_MMU *mmu, uint32_t begin, uint32_t size);
+extern void init_MMU(SLv6_MMU *mmu);
+
+/* initialize the MMU of the core core_id, which shares the pages and the
+ * devices of main; the devices must be added to main before */
+extern void init_shared_MMU(SLv6_MMU *mmu, SLv6_MMU *main,
+                            struct SLv6_ExclusiveMonitor*, uint32_t core_id);
 extern void destruct_MMU(SLv6_MMU *mmu);
 
+/* map a device; its pages must not be already mapped to a device */
+extern void slv6_add_device(SLv6_MMU*, struct SLv6_Device*);
+
+/* call the function advance of the devices */
+extern void slv6_advance_devices_aux(SLv6_MMU*, uint32_t n);
+static inline void slv6_advance_devices(SLv6_MMU *mmu, uint32_t n) {
+  if (mmu->devices) slv6_advance_devices_aux(mmu,n);
+}
+
+/* tell if a device may raise an interrupt (see may_interrupt) */
+extern bool slv6_may_interrupt_aux(SLv6_MMU*);
+static inline bool slv6_may_interrupt(SLv6_MMU *mmu) {
+  return mmu->devices && slv6_may_interrupt_aux(mmu);
+}
+
+/* invalidate the instructions written by the other cores; if the queue
+ * has overflowed, all the decoded instructions are invalidated. Called by
+ * the thread of the core, between two instructions or two blocks. */
+extern void slv6_drain_code_writes_aux(SLv6_MMU*);
+static inline void slv6_drain_code_writes(SLv6_MMU *mmu) {
+  if (SLV6_ATOMIC_LOAD(&mmu->code_write_count,RELAXED))
+    slv6_drain_code_writes_aux(mmu);
+}
+
+/* return the host address of addr, when the page of addr is not in the
+ * cache of last used pages. The page is allocated if needed. Return NULL
+ * if the page is mapped to a device. */
+extern uint8_t *slv6_mem_lookup(SLv6_MMU*, uint32_t addr);
+
+/* return the host address of addr, or NULL if it belongs to a device */
+static inline uint8_t *slv6_mem_ptr(SLv6_MMU *mmu, uint32_t addr) {
+  const uint32_t page = addr>>SLV6_MEM_PAGE_BITS;
+  const struct SLv6_MemCacheEntry *e = &mmu->cache[page&(SLV6_MEM_CACHE_SIZE-1)];
+  if (e->page==page)
+    return e->mem+SLV6_MEM_OFFSET(addr);
+  return slv6_mem_lookup(mmu,addr);
+}
+
 extern uint8_t slv6_read_byte(SLv6_MMU*, uint32_t addr);
 extern uint16_t slv6_read_half(SLv6_MMU*, uint32_t addr);
 extern uint32_t slv6_read_word(SLv6_MMU*, uint32_t addr);
@@ -26,6 +158,60 @@ extern void slv6_write_byte(SLv6_MMU*, uint32_t addr, uint8_t data);
 extern void slv6_write_half(SLv6_MMU*, uint32_t addr, uint16_t data);
 extern void slv6_write_word(SLv6_MMU*, uint32_t addr, uint32_t data);
 
+/* the page of addr contains decoded instructions, so the writes to this
+ * page must use the slow path, on every core */
+static inline void slv6_mem_code_page(SLv6_MMU *mmu, uint32_t addr) {
+  const uint32_t page = addr>>SLV6_MEM_PAGE_BITS;
+  SLv6_MMU *m = mmu;
+  do {
+    struct SLv6_MemCacheEntry *e = &m->wcache[page&(SLV6_MEM_CACHE_SIZE-1)];
+    if (SLV6_ATOMIC_LOAD(&e->page,SEQ_CST)==page)
+      SLV6_ATOMIC_STORE(&e->page,~0u,SEQ_CST);
+  } while ((m = m->next_core)!=mmu);
+}
+
+/* Fast path. When debugging, the slow path is always used, so that the
+ * accesses are printed. */
+#ifdef NDEBUG
+#define SLV6_FAST_MEM_HIT(e,page) ((e)->page==(page))
+#else
+#define SLV6_FAST_MEM_HIT(e,page) ((e)->page==(page) && !sl_debug)
+#endif
+
+#define SLV6_FAST_READ(type,name)                                 \
+  static inline type slv6_fast_read_##name(SLv6_MMU *mmu, uint32_t addr) { \
+    const uint32_t page = addr>>SLV6_MEM_PAGE_BITS;                     \
+    const struct SLv6_MemCacheEntry *e =                                \
+      &mmu->cache[page&(SLV6_MEM_CACHE_SIZE-1)];                        \
+    if (SLV6_FAST_MEM_HIT(e,page)) {                                    \
+      type data;                                                        \
+      assert((addr&(sizeof(type)-1))==0 && "misaligned acces");         \
+      memcpy(&data,e->mem+SLV6_MEM_OFFSET(addr),sizeof(type));          \
+      return data;                                                      \
+    }                                                                   \
+    return slv6_read_##name(mmu,addr);                                  \
+  }
+
+#define SLV6_FAST_WRITE(type,name)                                      \
+  static inline void slv6_fast_write_##name(SLv6_MMU *mmu, uint32_t addr, \
+                                            type data) {                \
+    const uint32_t page = addr>>SLV6_MEM_PAGE_BITS;                     \
+    const struct SLv6_MemCacheEntry *e =                                \
+      &mmu->wcache[page&(SLV6_MEM_CACHE_SIZE-1)];                       \
+    if (SLV6_FAST_MEM_HIT(e,page)) {                                    \
+      assert((addr&(sizeof(type)-1))==0 && "misaligned acces");         \
+      memcpy(e->mem+SLV6_MEM_OFFSET(addr),&data,sizeof(type));          \
+    } else                                                              \
+      slv6_write_##name(mmu,addr,data);                                 \
+  }
+
+SLV6_FAST_READ(uint8_t,byte)
+SLV6_FAST_READ(uint16_t,half)
+SLV6_FAST_READ(uint32_t,word)
+SLV6_FAST_WRITE(uint8_t,byte)
+SLV6_FAST_WRITE(uint16_t,half)
+SLV6_FAST_WRITE(uint32_t,word)
+
 /* We do not have a real MMU, so an address cannot be protected */
 static inline uint8_t slv6_read_byte_as_user(SLv6_MMU *mmu, uint32_t addr) {
   return slv6_read_byte(mmu,addr);
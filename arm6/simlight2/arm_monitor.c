@@ -0,0 +1,83 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Global exclusive monitor, used by LDREX and STREX when several cores
+ * share the memory (see slv6_smp.h) */
+
+#include "arm_monitor.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+#define LOAD(p) __atomic_load_n(p,__ATOMIC_SEQ_CST)
+#define STORE(p,v) __atomic_store_n(p,v,__ATOMIC_SEQ_CST)
+/* if *p==*e, set *p to v; otherwise, copy *p to *e */
+#define CAS(p,e,v)                                                      \
+  __atomic_compare_exchange_n(p,e,v,false,__ATOMIC_SEQ_CST,__ATOMIC_SEQ_CST)
+
+void init_ExclusiveMonitor(struct SLv6_ExclusiveMonitor *mon, uint32_t core_count) {
+  uint32_t i;
+  assert(core_count<=SLV6_MAX_CORES);
+  mon->core_count = core_count;
+  for (i = 0; i<SLV6_MAX_CORES; ++i)
+    mon->records[i].value = 0;
+}
+
+void slv6_monitor_reserve(struct SLv6_ExclusiveMonitor *mon, uint32_t core,
+                          uint32_t addr) {
+  STORE(&mon->records[core].value,SLV6_EXCL_ADDR(addr)|SLV6_EXCL_RESERVED);
+  /* the memory must not be read before the reservation is visible */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* clear the record r if it contains a reservation of the granule g, and
+ * return the state of the record for g (0 if r is not about g) */
+static uint32_t clear_reservation(uint32_t *r, uint32_t g) {
+  uint32_t v = LOAD(r);
+  while (v==(g|SLV6_EXCL_RESERVED))
+    if (CAS(r,&v,0))
+      return 0;
+  return v==(g|SLV6_EXCL_CLAIMED) ? SLV6_EXCL_CLAIMED : 0;
+}
+
+bool slv6_monitor_claim(struct SLv6_ExclusiveMonitor *mon, uint32_t core,
+                        uint32_t addr) {
+  const uint32_t g = SLV6_EXCL_ADDR(addr);
+  uint32_t *own = &mon->records[core].value;
+  uint32_t v = g|SLV6_EXCL_RESERVED;
+  uint32_t i;
+  if (!CAS(own,&v,g|SLV6_EXCL_CLAIMED))
+    return false;
+  for (i = 0; i<mon->core_count; ++i)
+    if (i!=core && clear_reservation(&mon->records[i].value,g)) {
+      DEBUG(printf("core %d: STREX at %x conflicts with core %d\n",core,addr,i));
+      STORE(own,0);
+      return false;
+    }
+  /* a core may have written the granule since the claim */
+  return LOAD(own)==(g|SLV6_EXCL_CLAIMED);
+}
+
+void slv6_monitor_clear(struct SLv6_ExclusiveMonitor *mon, uint32_t core,
+                        uint32_t addr) {
+  const uint32_t g = SLV6_EXCL_ADDR(addr);
+  uint32_t *own = &mon->records[core].value;
+  uint32_t i, v;
+  /* the records must not be read before the write is visible */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  for (i = 0; i<mon->core_count; ++i)
+    if (i!=core) {
+      uint32_t *r = &mon->records[i].value;
+      v = LOAD(r);
+      while (SLV6_EXCL_ADDR(v)==g && v!=0)
+        if (CAS(r,&v,0))
+          break;
+    }
+  v = g|SLV6_EXCL_CLAIMED;
+  CAS(own,&v,0);
+}
+
+void slv6_monitor_release(struct SLv6_ExclusiveMonitor *mon, uint32_t core) {
+  STORE(&mon->records[core].value,0);
+}
+
+END_SIMSOC_NAMESPACE
@@ -0,0 +1,118 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Global exclusive monitor, used by LDREX and STREX when several cores
+ * share the memory (see slv6_smp.h) */
+
+/* The monitor contains one record per core. The record of a core
+ * contains the granule (SLV6_EXCL_GRANULE bytes) reserved by its last
+ * LDREX, and a state:
+ * - reserved: LDREX has been executed;
+ * - claimed: STREX has checked the reservation (IsExclusiveGlobal), and
+ *   is writing the memory.
+ * A record is written by its core, and cleared (set to 0) by the other
+ * cores when they write to the same granule. All the accesses to the
+ * records are atomic operations (gcc __atomic builtins): there is no
+ * lock, and a record is written only when a core uses the exclusive
+ * instructions or writes to a granule reserved by another core.
+ *
+ * The reservation is made before the memory is read by LDREX (see
+ * slv6_read_word_exclusive): if it were made after, as in the
+ * pseudo-code, a write done between the read and the reservation would
+ * not clear it. For the same reason, a core which writes the memory
+ * clears the records after the write (ClearExclusiveByAddress).
+ *
+ * Two cores may claim the same granule at the same time. In this case,
+ * at least one of them sees the claim of the other one, and fails. Both
+ * may fail, which is allowed by the architecture (the program retries).
+ *
+ * If there is only one core, mmu->monitor is NULL, Shared returns false,
+ * and only the local monitor of the processor is used (see
+ * slv6_processor.h). */
+
+#ifndef ARM_MONITOR_H
+#define ARM_MONITOR_H
+
+#include "common.h"
+#include "arm_mmu.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+#define SLV6_MAX_CORES 32
+
+#define SLV6_EXCL_GRANULE_BITS 3
+#define SLV6_EXCL_GRANULE (1u<<SLV6_EXCL_GRANULE_BITS)
+#define SLV6_EXCL_ADDR(addr) ((addr)&~(SLV6_EXCL_GRANULE-1))
+
+/* states of a record (the low bits of the granule address are 0) */
+#define SLV6_EXCL_RESERVED 1
+#define SLV6_EXCL_CLAIMED 2
+
+struct SLv6_ExclusiveRecord {
+  uint32_t value; /* granule address | state, or 0 */
+  char padding[60]; /* the records of two cores are in different cache lines */
+};
+
+struct SLv6_ExclusiveMonitor {
+  uint32_t core_count;
+  struct SLv6_ExclusiveRecord records[SLV6_MAX_CORES];
+};
+
+extern void init_ExclusiveMonitor(struct SLv6_ExclusiveMonitor*, uint32_t core_count);
+
+/* reserve the granule of addr for the core */
+extern void slv6_monitor_reserve(struct SLv6_ExclusiveMonitor*, uint32_t core,
+                                 uint32_t addr);
+
+/* claim the reservation of the granule of addr; return false if the core
+ * has no such reservation, or if another core is claiming it */
+extern bool slv6_monitor_claim(struct SLv6_ExclusiveMonitor*, uint32_t core,
+                               uint32_t addr);
+
+/* called after a write to addr: clear the reservations and claims of the
+ * other cores on the granule of addr, and release the claim of the core */
+extern void slv6_monitor_clear(struct SLv6_ExclusiveMonitor*, uint32_t core,
+                               uint32_t addr);
+
+/* clear the record of the core */
+extern void slv6_monitor_release(struct SLv6_ExclusiveMonitor*, uint32_t core);
+
+/* memory read of LDREX: the granule is reserved before being read */
+static inline uint32_t slv6_read_word_exclusive(SLv6_MMU *mmu, uint32_t addr) {
+  if (mmu->monitor)
+    slv6_monitor_reserve(mmu->monitor,mmu->core_id,addr);
+  return slv6_read_word(mmu,addr);
+}
+
+/* Functions used by the pseudo-code. The processor_id argument is equal
+ * to mmu->core_id (see ExecutingProcessor in slv6_processor.h) */
+
+static inline bool Shared(SLv6_MMU *mmu, uint32_t address) {
+  return mmu->monitor!=NULL;
+}
+
+/* the reservation has been done by slv6_read_word_exclusive */
+static inline void MarkExclusiveGlobal(SLv6_MMU *mmu, uint32_t physical_address,
+                                       size_t processor_id, uint32_t size) {}
+
+static inline bool IsExclusiveGlobal(SLv6_MMU *mmu, uint32_t physical_address,
+                                     size_t processor_id, uint32_t size) {
+  assert(processor_id==mmu->core_id);
+  return slv6_monitor_claim(mmu->monitor,mmu->core_id,physical_address);
+}
+
+static inline void ClearExclusiveByAddress3(SLv6_MMU *mmu, uint32_t physical_address,
+                                            size_t processor_id, uint32_t size) {
+  assert(processor_id==mmu->core_id);
+  slv6_monitor_clear(mmu->monitor,mmu->core_id,physical_address);
+}
+
+/* Thumb instructions do not give the processor id */
+static inline void ClearExclusiveByAddress2(SLv6_MMU *mmu, uint32_t physical_address,
+                                            uint32_t size) {
+  slv6_monitor_clear(mmu->monitor,mmu->core_id,physical_address);
+}
+
+END_SIMSOC_NAMESPACE
+
+#endif /* ARM_MONITOR_H */
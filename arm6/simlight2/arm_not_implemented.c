@@ -2,6 +2,7 @@
 /* See the COPYRIGHTS and LICENSE files. */
 
 #include "arm_not_implemented.h"
+#include "slv6_processor.h"
 
 bool slv6_CDP_dependent_operation(struct SLv6_Processor *proc, uint8_t n) {
   TODO("coprocessor dependent_operation");
@@ -30,5 +31,10 @@ bool slv6_MRRC_second_value(struct SLv6_Processor *proc,
 bool slv6_MRC_value(struct SLv6_Processor *proc, uint32_t *result, uint8_t n,
                            uint8_t opcode_1, uint8_t opcode_2,
                            uint8_t CRn, uint8_t CRm) {
+  /* CPU ID register of the ARM11 MPCore, giving the index of the core */
+  if (n==15 && opcode_1==0 && CRn==0 && CRm==0 && opcode_2==5) {
+    *result = proc->id;
+    return true;
+  }
   TODO("coprocessor value");
 }
@@ -15,9 +15,11 @@
 
 #define unpredictable(msg) ERROR("simulating something unpredictable, inside: " msg)
 
+#ifndef __cplusplus
 typedef char bool;
 #define true 1
 #define false 0
+#endif
 
 extern bool sl_debug;
 extern bool sl_info;
@@ -39,4 +41,24 @@ extern bool sl_exec;
 #define SLV6_HOT
 #define SLV6_COLD
 
+/* Atomic accesses to the data shared by the cores (see slv6_smp.h).
+ * CompCert has no atomic operations, so the Coq representation of
+ * simlight (make proof), which simulates one core, is built with
+ * SLV6_PROOF, and uses plain accesses. */
+#ifdef SLV6_PROOF
+#define SLV6_ATOMIC_LOAD(p,order) (*(p))
+#define SLV6_ATOMIC_STORE(p,v,order) (*(p) = (v))
+#define SLV6_ATOMIC_FETCH_ADD(p,v) ((*(p) += (v)) - (v))
+#define SLV6_ATOMIC_CAS(p,e,v)                                          \
+  (*(p)==*(e) ? (*(p) = (v), true) : (*(e) = *(p), false))
+#define SLV6_ATOMIC_FENCE() ((void) 0)
+#else
+#define SLV6_ATOMIC_LOAD(p,order) __atomic_load_n(p,__ATOMIC_##order)
+#define SLV6_ATOMIC_STORE(p,v,order) __atomic_store_n(p,v,__ATOMIC_##order)
+#define SLV6_ATOMIC_FETCH_ADD(p,v) __atomic_fetch_add(p,v,__ATOMIC_ACQ_REL)
+#define SLV6_ATOMIC_CAS(p,e,v)                                          \
+  __atomic_compare_exchange_n(p,e,v,false,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)
+#define SLV6_ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
 #endif /* COMMON_H */
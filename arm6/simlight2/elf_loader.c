@@ -179,6 +179,7 @@ void ef_init_ElfFile(struct ElfFile *ef, const char *elf_file) {
 
 void ef_destruct_ElfFile(struct ElfFile *ef) {
   fclose(ef->ifs);
+  eh_destruct_Elf32_Header(&ef->header);
 }
 
 bool ef_is_ARM(const struct ElfFile *ef) {
@@ -3,10 +3,21 @@
 #include "common.h"
 #include "elf_loader.h"
 #include "slv6_iss_printers.h"
+#include "slv6_decode_cache.h"
+#include "slv6_basic_block.h"
+#include "slv6_profile.h"
+#include "arm_devices.h"
+#include "slv6_smp.h"
+#include "slv6_checkpoint.h"
+#include "slv6_trace.h"
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
-/* function used by the ELF loader */
-static SLv6_MMU *mmu_ptr = NULL;
+/* function used by the ELF loader (the batch mode loads several files
+ * at the same time, in different threads) */
+static __thread SLv6_MMU *mmu_ptr = NULL;
 void elf_write_to_memory(const char *data, size_t start, size_t size) {
   assert(mmu_ptr);
   uint32_t j;
@@ -70,17 +81,34 @@ bool done(bool T, uint32_t arm, uint16_t thumb) {
     return arm==arm_infinite_loop;
 }
 
-void simulate(struct SLv6_Processor *proc, struct ElfFile *elf) {
-  uint32_t inst_count = 0;
-  uint32_t arm_bincode;
-  uint16_t thumb_bincode;
-  bool found;
+/* set the pc to the entry point of the ELF file */
+void set_entry_point(struct SLv6_Processor *proc, struct ElfFile *elf) {
   const uint32_t entry = ef_get_initial_pc(elf);
   INFO(printf("entry point: %x\n", entry));
   set_pc(proc,entry);
   proc->jump = false;
+}
+
+/* if not 0, the simulation stops after stop_count instructions (option
+ * -stop), or at the end of the block which reaches it */
+static uint32_t stop_count = 0;
+
+static bool stopped(uint32_t inst_count) {
+  return stop_count && inst_count>=stop_count;
+}
+
+/* execute the program from the current pc until it reaches an infinite
+ * loop which no interrupt may leave (see slv6_interruptible); the
+ * simulate functions return the number of instructions executed */
+uint32_t simulate(struct SLv6_Processor *proc) {
+  uint32_t inst_count = 0;
+  uint32_t arm_bincode;
+  uint16_t thumb_bincode;
+  bool found;
   do {
     DEBUG(puts("---------------------"));
+    if (proc->pending)
+      slv6_take_interrupt(proc);
     if (proc->cpsr.T_flag) {
       thumb_bincode = slv6_read_half(proc->mmu_ptr,address_of_current_instruction(proc));
       found = thumb_decode_and_exec(proc,thumb_bincode);
@@ -95,10 +123,442 @@ void simulate(struct SLv6_Processor *proc, struct ElfFile *elf) {
     else
       increment_pc(proc);
     slv6_hook(proc);
+    slv6_advance_devices(proc->mmu_ptr,1);
+    ++inst_count;
+  } while ((!done(proc->cpsr.T_flag,arm_bincode,thumb_bincode) ||
+            slv6_interruptible(proc)) && !stopped(inst_count));
+  DEBUG(puts("---------------------"));
+  INFO(printf("%s after %d instructions executed.\n",
+              stopped(inst_count) ? "Stopped" : "Reached infinite loop", inst_count));
+  return inst_count;
+}
+
+/* same as simulate, but each instruction is decoded only once.
+ * The infinite loop is recognized because it jumps to itself.
+ * If prof is not NULL, the executed instructions are counted.
+ * If trace is not NULL, the execution is traced. */
+uint32_t simulate_cached(struct SLv6_Processor *proc, struct SLv6_Profile *prof,
+                         struct SLv6_TraceBuffer *trace) {
+  uint32_t inst_count = 0;
+  uint32_t addr;
+  struct SLv6_Instruction *instr;
+  struct SLv6_DecodeCache *dc = proc->mmu_ptr->dc;
+  do {
+    DEBUG(puts("---------------------"));
+    if (proc->pending)
+      slv6_take_interrupt(proc);
+    addr = address_of_current_instruction(proc);
+    if (proc->cpsr.T_flag)
+      instr = slv6_dc_thumb_lookup(dc,proc->mmu_ptr,addr);
+    else
+      instr = slv6_dc_arm_lookup(dc,proc->mmu_ptr,addr);
+    if (trace)
+      slv6_trace_instr(trace,proc,addr,instr->args.g0.id);
+    instr->sem_fct(proc,instr);
+    if (prof)
+      slv6_profile_count(prof,instr);
+    if (proc->jump)
+      proc->jump = false;
+    else
+      increment_pc(proc);
+    if (trace)
+      slv6_trace_end(trace,proc);
+    slv6_hook(proc);
+    slv6_advance_devices(proc->mmu_ptr,1);
     ++inst_count;
-  } while (!done(proc->cpsr.T_flag,arm_bincode,thumb_bincode));
+  } while ((address_of_current_instruction(proc)!=addr || slv6_interruptible(proc))
+           && !stopped(inst_count));
+  DEBUG(puts("---------------------"));
+  INFO(printf("%s after %d instructions executed.\n",
+              stopped(inst_count) ? "Stopped" : "Reached infinite loop", inst_count));
+  INFO(printf("%d instructions decoded.\n", dc->decode_count));
+  return inst_count;
+}
+
+/* same as simulate_cached, but the instructions are executed by basic
+ * blocks, which are chained together */
+uint32_t simulate_bb(struct SLv6_Processor *proc) {
+  uint32_t inst_count = 0;
+  uint32_t last;
+  struct SLv6_BlockCache *bc = proc->mmu_ptr->bc;
+  struct SLv6_BasicBlock *bb;
+  bb = slv6_bb_lookup(bc,proc);
+  for (;;) {
+    DEBUG(printf("--------------------- block %x\n", bb->start));
+    slv6_bb_exec(proc,bb);
+    slv6_hook(proc);
+    slv6_advance_devices(proc->mmu_ptr,bb->size);
+    inst_count += bb->size;
+    last = bb->start+(bb->size-1)*(bb->thumb ? 2 : 4);
+    if ((address_of_current_instruction(proc)==last && !slv6_interruptible(proc))
+        || stopped(inst_count))
+      break;
+    if (proc->pending)
+      slv6_take_interrupt(proc);
+    if (bc->flush_pending) {
+      slv6_bc_flush(bc);
+      bb = slv6_bb_lookup(bc,proc);
+    } else
+      bb = slv6_bb_next(bc,proc,bb);
+  }
   DEBUG(puts("---------------------"));
-  INFO(printf("Reached infinite loop after %d instructions executed.\n", inst_count));
+  INFO(printf("%s after %d instructions executed.\n",
+              stopped(inst_count) ? "Stopped" : "Reached infinite loop", inst_count));
+  INFO(printf("%d basic blocks translated, %d flushes.\n",
+              bc->block_count, bc->flush_count));
+  return inst_count;
+}
+
+#ifdef SLV6_JIT
+/* same as simulate_bb, but hot blocks are translated to native code. A
+ * native block may stop before its end, if it requests a flush (see
+ * slv6_jit.h): the execution continues at the next instruction after the
+ * flush. */
+uint32_t simulate_jit(struct SLv6_Processor *proc, struct SLv6_Jit *jit) {
+  uint32_t inst_count = 0;
+  uint32_t last, n;
+  struct SLv6_BlockCache *bc = proc->mmu_ptr->bc;
+  struct SLv6_BasicBlock *bb;
+  bb = slv6_bb_lookup(bc,proc);
+  for (;;) {
+    DEBUG(printf("--------------------- block %x\n", bb->start));
+    if (bb->native)
+      n = bb->native(proc);
+    else {
+      if (++bb->exec_count==SLV6_JIT_THRESHOLD)
+        bb->native = slv6_jit_compile(jit,bb->instrs,bb->size,bb->thumb);
+      slv6_bb_exec(proc,bb);
+      n = bb->size;
+    }
+    slv6_hook(proc);
+    slv6_advance_devices(proc->mmu_ptr,n);
+    inst_count += n;
+    last = bb->start+(bb->size-1)*(bb->thumb ? 2 : 4);
+    if ((n==bb->size && address_of_current_instruction(proc)==last &&
+         !slv6_interruptible(proc)) || stopped(inst_count))
+      break;
+    if (proc->pending)
+      slv6_take_interrupt(proc);
+    if (bc->flush_pending) {
+      slv6_jit_flush(jit);
+      slv6_bc_flush(bc);
+      bb = slv6_bb_lookup(bc,proc);
+    } else
+      bb = slv6_bb_next(bc,proc,bb);
+  }
+  DEBUG(puts("---------------------"));
+  INFO(printf("%s after %d instructions executed.\n",
+              stopped(inst_count) ? "Stopped" : "Reached infinite loop", inst_count));
+  INFO(printf("%d basic blocks translated, %d compiled to native code, %d flushes.\n",
+              bc->block_count, slv6_jit_block_count(jit), bc->flush_count));
+  return inst_count;
+}
+#endif
+
+/* Batch mode: the ELF files listed in a manifest are simulated by a pool
+ * of threads. Each line of the manifest contains an ELF file name,
+ * relative to the directory of the manifest, and the expected value of
+ * r0 (same format as -r0=N). Empty lines and lines starting with '#'
+ * are ignored. Each test has its own processor, MMU and caches; a test
+ * which aborts (TODO, ERROR, ...) stops the whole batch. */
+
+struct BatchTest {
+  char *filename;
+  uint32_t expected_r0;
+  bool hexa_r0;
+  /* results */
+  uint32_t r0;
+  uint32_t inst_count;
+  double time; /* in seconds */
+};
+
+struct Batch {
+  struct BatchTest *tests;
+  uint32_t count;
+  uint32_t next; /* index of the next test to run (atomic) */
+  bool cache;
+  bool basic_blocks;
+};
+
+static double elapsed(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC,&now);
+  return (now.tv_sec-start->tv_sec)+(now.tv_nsec-start->tv_nsec)*1e-9;
+}
+
+static void read_manifest(struct Batch *batch, const char *manifest) {
+  FILE *f = fopen(manifest,"r");
+  char line[1024], name[1024], r0[64];
+  const char *slash = strrchr(manifest,'/');
+  const size_t dir_len = slash ? slash+1-manifest : 0;
+  uint32_t capacity = 64, n = 0;
+  if (!f) {
+    fprintf(stderr,"failed to open file \"%s\"\n",manifest);
+    exit(1);
+  }
+  batch->tests = (struct BatchTest*) malloc(capacity*sizeof(struct BatchTest));
+  while (fgets(line,sizeof(line),f)) {
+    ++n;
+    if (sscanf(line,"%1023s",name)!=1 || name[0]=='#')
+      continue;
+    if (sscanf(line,"%*s %63s",r0)!=1) {
+      fprintf(stderr,"%s:%d: no expected value of r0\n",manifest,n);
+      exit(1);
+    }
+    if (batch->count==capacity) {
+      capacity *= 2;
+      batch->tests = (struct BatchTest*)
+        realloc(batch->tests,capacity*sizeof(struct BatchTest));
+    }
+    struct BatchTest *t = &batch->tests[batch->count++];
+    if (name[0]=='/')
+      t->filename = strdup(name);
+    else {
+      t->filename = (char*) malloc(dir_len+strlen(name)+1);
+      memcpy(t->filename,manifest,dir_len);
+      strcpy(t->filename+dir_len,name);
+    }
+    t->expected_r0 = strtoul(r0,NULL,0);
+    t->hexa_r0 = !strncmp(r0,"0x",2);
+    /* ef_init_ElfFile exits if the file is missing: fail before
+     * starting the simulations */
+    if (access(t->filename,R_OK)) {
+      fprintf(stderr,"%s:%d: failed to open file \"%s\"\n",manifest,n,t->filename);
+      exit(1);
+    }
+  }
+  fclose(f);
+}
+
+static void run_test(struct Batch *batch, struct BatchTest *t) {
+  struct SLv6_Processor proc;
+  SLv6_MMU mmu;
+  SLv6_SystemCoproc cp15;
+  struct SLv6_DecodeCache dc;
+  struct SLv6_BlockCache bc;
+  struct ElfFile elf;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC,&start);
+  init_MMU(&mmu);
+  init_CP15(&cp15);
+  mmu_ptr = &mmu;
+  init_Processor(&proc,&mmu,&cp15);
+#ifdef SLV6_THUMB_TABLE
+  slv6_init_thumb_table();
+#endif
+  ef_init_ElfFile(&elf,t->filename);
+  ef_load_sections(&elf);
+  if (batch->cache) {
+    init_DecodeCache(&dc);
+    mmu.dc = &dc;
+  }
+  set_entry_point(&proc,&elf);
+  if (batch->basic_blocks) {
+    init_BlockCache(&bc,&dc);
+    mmu.bc = &bc;
+    t->inst_count = simulate_bb(&proc);
+  } else if (batch->cache)
+    t->inst_count = simulate_cached(&proc,NULL,NULL);
+  else
+    t->inst_count = simulate(&proc);
+  t->r0 = reg(&proc,0);
+  ef_destruct_ElfFile(&elf);
+  destruct_Processor(&proc);
+  if (mmu.bc) destruct_BlockCache(mmu.bc);
+  if (mmu.dc) destruct_DecodeCache(mmu.dc);
+  t->time = elapsed(&start);
+}
+
+static void *batch_worker(void *arg) {
+  struct Batch *batch = (struct Batch*) arg;
+  uint32_t i;
+  while ((i = __atomic_fetch_add(&batch->next,1,__ATOMIC_RELAXED))<batch->count)
+    run_test(batch,&batch->tests[i]);
+  return NULL;
+}
+
+/* return the exit status: 0 if all the tests pass, 4 otherwise */
+int run_batch(const char *manifest, uint32_t jobs, bool cache, bool basic_blocks) {
+  struct Batch batch = {NULL, 0, 0, cache, basic_blocks};
+  pthread_t *threads;
+  struct timespec start;
+  uint32_t i, failures = 0;
+  uint64_t total = 0;
+  read_manifest(&batch,manifest);
+  if (jobs>batch.count)
+    jobs = batch.count ? batch.count : 1;
+  /* the messages of the simulations would be interleaved */
+  sl_debug = sl_info = false;
+#ifdef SLV6_THREADED
+  /* initialize the table of labels before starting the threads */
+  slv6_threaded_label(0);
+#endif
+  clock_gettime(CLOCK_MONOTONIC,&start);
+  threads = (pthread_t*) malloc(jobs*sizeof(pthread_t));
+  for (i = 0; i<jobs; ++i)
+    if (pthread_create(&threads[i],NULL,batch_worker,&batch)) {
+      fprintf(stderr,"failed to create thread %d\n",i);
+      exit(1);
+    }
+  for (i = 0; i<jobs; ++i)
+    pthread_join(threads[i],NULL);
+  free(threads);
+  for (i = 0; i<batch.count; ++i) {
+    struct BatchTest *t = &batch.tests[i];
+    const bool ok = t->r0==t->expected_r0;
+    printf("%s %-40s %12d instructions %9.3f s",
+           ok ? "PASS" : "FAIL", t->filename, t->inst_count, t->time);
+    if (ok)
+      putchar('\n');
+    else if (t->hexa_r0)
+      printf("  r0 contains %x instead of %x\n",t->r0,t->expected_r0);
+    else
+      printf("  r0 contains %d instead of %d\n",t->r0,t->expected_r0);
+    failures += !ok;
+    total += t->inst_count;
+    free(t->filename);
+  }
+  printf("%d tests, %d failures, %" PRIu64 " instructions, %.3f s (%d threads)\n",
+         batch.count, failures, total, elapsed(&start), jobs);
+  free(batch.tests);
+  return failures ? 4 : 0;
+}
+
+/* Server mode: the ELF file is loaded (or the checkpoint is restored)
+ * once, and the decode cache is filled with the instructions of the
+ * .text section of the ELF file. Then, for each
+ * request read on the standard input, a child process is forked; it
+ * writes the input of the request into its copy-on-write copy of the
+ * memory, simulates the program, and sends the result to the server,
+ * which forwards it on the standard output. The child messages are
+ * redirected to the standard error.
+ *
+ * A request is made of four words (host byte order): the address and
+ * the size of the input, and the address and the size of the output;
+ * followed by the input bytes. The response is made of three words: a
+ * status (0 if the child has reached the infinite loop, the wait
+ * status of the child otherwise), r0, and the number of instructions
+ * executed; followed by the output bytes, read from the memory at the
+ * end of the simulation (0 if the status is not 0). The server stops
+ * at the end of the standard input. */
+
+struct ServerRequest {
+  uint32_t input_addr, input_size;
+  uint32_t output_addr, output_size;
+};
+
+struct ServerResponse {
+  uint32_t status;
+  uint32_t r0;
+  uint32_t inst_count;
+};
+
+/* return false if the end of file is reached before size bytes */
+static bool read_all(int fd, void *buf, size_t size) {
+  char *p = (char*) buf;
+  while (size) {
+    const ssize_t n = read(fd,p,size);
+    if (n<=0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static void write_all(int fd, const void *buf, size_t size) {
+  const char *p = (const char*) buf;
+  while (size) {
+    const ssize_t n = write(fd,p,size);
+    if (n<=0) {
+      perror("server");
+      exit(1);
+    }
+    p += n;
+    size -= n;
+  }
+}
+
+/* decode the .text section, in the mode of the entry point */
+static void warm_decode_cache(struct SLv6_Processor *proc, struct ElfFile *elf) {
+  struct SLv6_DecodeCache *dc = proc->mmu_ptr->dc;
+  uint32_t a = ef_get_text_start(elf);
+  const uint32_t ea = a + ef_get_text_size(elf);
+  if (ef_get_initial_pc(elf)&1)
+    for (a &= ~1; a<ea; a+=2)
+      slv6_dc_thumb_lookup(dc,proc->mmu_ptr,a);
+  else
+    for (a &= ~3; a<ea; a+=4)
+      slv6_dc_arm_lookup(dc,proc->mmu_ptr,a);
+}
+
+/* executed by the child process */
+static void serve_request(struct SLv6_Processor *proc,
+                          const struct ServerRequest *req, const uint8_t *input,
+                          uint8_t *output, int fd) {
+  SLv6_MMU *mmu = proc->mmu_ptr;
+  struct ServerResponse resp;
+  uint32_t j;
+  for (j = 0; j<req->input_size; ++j)
+    slv6_write_byte(mmu,req->input_addr+j,input[j]);
+  if (mmu->bc)
+    resp.inst_count = simulate_bb(proc);
+  else if (mmu->dc)
+    resp.inst_count = simulate_cached(proc,NULL,NULL);
+  else
+    resp.inst_count = simulate(proc);
+  resp.status = 0;
+  resp.r0 = reg(proc,0);
+  for (j = 0; j<req->output_size; ++j)
+    output[j] = slv6_read_byte(mmu,req->output_addr+j);
+  write_all(fd,&resp,sizeof(resp));
+  write_all(fd,output,req->output_size);
+}
+
+/* elf is NULL if the state has been restored from a checkpoint */
+void run_server(struct SLv6_Processor *proc, struct ElfFile *elf) {
+  struct ServerRequest req;
+  struct ServerResponse resp;
+  uint8_t *input = NULL, *output = NULL;
+  /* the standard output is used by the protocol */
+  sl_debug = sl_info = false;
+  if (elf && proc->mmu_ptr->dc)
+    warm_decode_cache(proc,elf);
+  while (read_all(0,&req,sizeof(req))) {
+    int fds[2], status;
+    pid_t pid;
+    bool ok;
+    input = (uint8_t*) realloc(input,req.input_size);
+    output = (uint8_t*) realloc(output,req.output_size);
+    if (!read_all(0,input,req.input_size)) {
+      fputs("server: truncated request\n",stderr);
+      exit(1);
+    }
+    if (pipe(fds) || (pid = fork())<0) {
+      perror("server");
+      exit(1);
+    }
+    if (pid==0) {
+      close(fds[0]);
+      dup2(2,1);
+      serve_request(proc,&req,input,output,fds[1]);
+      _exit(0);
+    }
+    close(fds[1]);
+    ok = read_all(fds[0],&resp,sizeof(resp)) &&
+      read_all(fds[0],output,req.output_size);
+    close(fds[0]);
+    waitpid(pid,&status,0);
+    if (!ok || status) {
+      resp.status = status ? status : 1;
+      resp.r0 = resp.inst_count = 0;
+      memset(output,0,req.output_size);
+    }
+    write_all(1,&resp,sizeof(resp));
+    write_all(1,output,req.output_size);
+  }
+  free(input);
+  free(output);
 }
 
 void usage(const char *pname) {
@@ -111,6 +571,29 @@ void usage(const char *pname) {
   puts("\t-dec  decode the .text section (turn off simulation)");
   puts("\t-Adec  decode the .text section using the ARM32 variant");
   puts("\t-Tdec  decode the .text section using the Thumb variant");
+  puts("\t-cache  decode each instruction only once (decoded instructions are cached)");
+  puts("\t-bb    execute chained basic blocks of decoded instructions (implies -cache)");
+  puts("\t-dev   map a console, a timer, and an interrupt controller (see arm_devices.h)");
+  puts("\t-smp=N  simulate N cores sharing the memory, each one in its own thread");
+  puts("\t        (see slv6_smp.h; implies -cache; r0 is the one of the first core)");
+  printf("\t-quantum=Q  with -smp, synchronize the cores every Q instructions\n"
+         "\t            (0: never; default: %d)\n", SLV6_DEFAULT_QUANTUM);
+  puts("\t-batch=F  simulate the ELF files listed in the manifest F, in parallel");
+  puts("\t          (one \"<elf_file> <expected r0>\" per line; no elf_file argument)");
+  puts("\t-jobs=N   with -batch, use N threads (default: number of processors)");
+  puts("\t-server  simulate the elf file once per request read on stdin, in a forked");
+  puts("\t         process (see the protocol in simlight.c)");
+  puts("\t-stop=N  stop the simulation after N instructions (with -bb: at the end of");
+  puts("\t         the block reaching N)");
+  puts("\t-save=F  save the state of the simulator in F at the end of the simulation");
+  puts("\t-restore=F  restore the state saved in F (replaces the elf_file argument)");
+  puts("\t-trace=F  write a binary trace of the execution in F (see slv6_trace.h;");
+  puts("\t          implies -cache; read it with trace_reader)");
+  puts("\t-prof=F  add the number of executions of each instruction to the weight file F");
+  puts("\t         (the format used by simgen -iwgt; implies -cache)");
+#ifdef SLV6_JIT
+  puts("\t-jit   translate hot basic blocks to native code using LLVM (implies -bb)");
+#endif
 }
 
 void slv6_P_undef_unpred(FILE *f, struct SLv6_Instruction *instr, uint32_t bincode) {
@@ -124,7 +607,20 @@ int main(int argc, const char *argv[]) {
   bool hexa_r0 = false;
   bool arm32 = false;
   bool thumb = false;
+  bool cache = false;
+  bool basic_blocks = false;
+  bool jit = false;
+  const char *profile_file = NULL;
+  bool devices = false;
+  uint32_t core_count = 1;
+  uint32_t quantum = SLV6_DEFAULT_QUANTUM;
   uint32_t expected_r0 = 0;
+  const char *manifest = NULL;
+  bool server = false;
+  const char *save_file = NULL;
+  const char *restore_file = NULL;
+  const char *trace_file = NULL;
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
   /* commmand line parsing */
   int i;
   for (i = 1; i<argc; ++i) {
@@ -147,6 +643,46 @@ int main(int argc, const char *argv[]) {
       } else if (!strcmp(argv[i],"-Tdec")) {
         sl_exec = false;
         thumb = true;
+      } else if (!strcmp(argv[i],"-cache")) {
+        cache = true;
+      } else if (!strcmp(argv[i],"-dev")) {
+        devices = true;
+      } else if (!strncmp(argv[i],"-smp=",5)) {
+        cache = true;
+        core_count = strtoul(argv[i]+5,NULL,0);
+        if (core_count<1 || core_count>SLV6_MAX_CORES) {
+          printf("Error: the number of cores must be between 1 and %d.\n",SLV6_MAX_CORES);
+          return 1;
+        }
+      } else if (!strncmp(argv[i],"-quantum=",9)) {
+        quantum = strtoul(argv[i]+9,NULL,0);
+      } else if (!strncmp(argv[i],"-stop=",6)) {
+        stop_count = strtoul(argv[i]+6,NULL,0);
+      } else if (!strncmp(argv[i],"-save=",6)) {
+        save_file = argv[i]+6;
+      } else if (!strncmp(argv[i],"-restore=",9)) {
+        restore_file = argv[i]+9;
+      } else if (!strncmp(argv[i],"-trace=",7)) {
+        cache = true;
+        trace_file = argv[i]+7;
+      } else if (!strcmp(argv[i],"-server")) {
+        server = true;
+      } else if (!strncmp(argv[i],"-batch=",7)) {
+        manifest = argv[i]+7;
+      } else if (!strncmp(argv[i],"-jobs=",6)) {
+        jobs = strtol(argv[i]+6,NULL,0);
+      } else if (!strncmp(argv[i],"-prof=",6)) {
+        cache = true;
+        profile_file = argv[i]+6;
+      } else if (!strcmp(argv[i],"-bb")) {
+        cache = true;
+        basic_blocks = true;
+#ifdef SLV6_JIT
+      } else if (!strcmp(argv[i],"-jit")) {
+        cache = true;
+        basic_blocks = true;
+        jit = true;
+#endif
       } else {
         printf("Error: unrecognized option: \"%s\".\n\n", argv[i]);
         usage(argv[0]);
@@ -161,7 +697,46 @@ int main(int argc, const char *argv[]) {
       filename = argv[i];
     }
   }
-  if (!filename) {
+  /* the profiling and the tracing are done instruction per instruction */
+  if (profile_file || trace_file)
+    basic_blocks = jit = false;
+  if (trace_file && (profile_file || server || manifest)) {
+    puts("Error: -trace cannot be used with -prof, -server or -batch.\n");
+    usage(argv[0]);
+    return 1;
+  }
+  if (core_count>1 && (devices || profile_file || jit || stop_count)) {
+    puts("Error: -dev, -prof, -jit and -stop cannot be used with several cores.\n");
+    usage(argv[0]);
+    return 1;
+  }
+  if (server && (!sl_exec || manifest || profile_file || jit || core_count>1)) {
+    puts("Error: -server cannot be used with -dec, -batch, -prof, -jit or -smp.\n");
+    usage(argv[0]);
+    return 1;
+  }
+  if (manifest) {
+    if (filename || !sl_exec || devices || profile_file || jit || core_count>1 ||
+        save_file || restore_file) {
+      puts("Error: -batch cannot be used with an elf file, -dec, -dev, -prof, -jit, -smp,\n"
+           "-save or -restore.\n");
+      usage(argv[0]);
+      return 1;
+    }
+    return run_batch(manifest,jobs>0 ? jobs : 1,cache,basic_blocks);
+  }
+  if ((save_file || restore_file) && (!sl_exec || devices || core_count>1)) {
+    puts("Error: -save and -restore cannot be used with -dec, -dev or -smp.\n");
+    usage(argv[0]);
+    return 1;
+  }
+  if (restore_file && filename) {
+    printf("Error: an elf file and a checkpoint: \"%s\" and \"%s\".\n\n",
+           filename,restore_file);
+    usage(argv[0]);
+    return 1;
+  }
+  if (!filename && !restore_file) {
     if (argc>1)
       puts("Error: no elf file.\n");
     usage(argv[0]);
@@ -173,20 +748,86 @@ int main(int argc, const char *argv[]) {
   struct SLv6_Processor proc;
   SLv6_MMU mmu;
   SLv6_SystemCoproc cp15;
-  init_MMU(&mmu, 4 /* memory start */, 0x100000 /* memory size */);
+  struct SLv6_DecodeCache dc;
+  struct SLv6_BlockCache bc;
+  struct SLv6_Devices devs;
+  init_MMU(&mmu);
   init_CP15(&cp15);
   mmu_ptr = &mmu;
   init_Processor(&proc,&mmu,&cp15);
-  /* load the ELF file */
-  struct ElfFile elf;
-  ef_init_ElfFile(&elf,filename);
-  { const bool tmp = sl_debug;
-    sl_debug = false;
-    ef_load_sections(&elf);
-    sl_debug = tmp;}
+#ifdef SLV6_THUMB_TABLE
+  slv6_init_thumb_table();
+#endif
+  if (devices)
+    init_Devices(&devs,&proc);
+  /* load the ELF file, or restore the checkpoint */
+  struct ElfFile elf, *elf_ptr = NULL;
+  if (restore_file)
+    slv6_restore_checkpoint(&proc,restore_file);
+  else {
+    elf_ptr = &elf;
+    ef_init_ElfFile(&elf,filename);
+    { const bool tmp = sl_debug;
+      sl_debug = false;
+      ef_load_sections(&elf);
+      sl_debug = tmp;}
+  }
   /* main task */
-  if (sl_exec)
-    simulate(&proc,&elf);
+  if (sl_exec && cache) {
+    init_DecodeCache(&dc);
+    mmu.dc = &dc;
+  }
+  if (sl_exec && basic_blocks) {
+    init_BlockCache(&bc,&dc);
+    mmu.bc = &bc;
+  }
+  if (sl_exec && elf_ptr)
+    set_entry_point(&proc,&elf);
+#ifdef SLV6_JIT
+  struct SLv6_Jit *jit_ptr = NULL;
+  if (sl_exec && jit) {
+    jit_ptr = slv6_jit_create(SLV6_JIT_BITCODE);
+    if (!jit_ptr)
+      puts("Warning: the JIT is disabled.");
+  }
+  if (jit_ptr) {
+    simulate_jit(&proc,jit_ptr);
+    slv6_jit_destroy(jit_ptr);
+  } else
+#endif
+  if (sl_exec && server)
+    run_server(&proc,elf_ptr);
+  else if (sl_exec && core_count>1) {
+    struct SLv6_Smp smp;
+    struct SLv6_TraceWriter tw;
+    init_Smp(&smp,core_count,&proc,quantum);
+    if (trace_file) {
+      init_TraceWriter(&tw,trace_file);
+      smp.trace_writer = &tw;
+    }
+    slv6_smp_run(&smp,ef_get_initial_pc(&elf));
+    if (trace_file) {
+      destruct_TraceWriter(&tw);
+      mmu.trace = NULL;
+    }
+    destruct_Smp(&smp);
+  } else if (sl_exec && basic_blocks)
+    simulate_bb(&proc);
+  else if (sl_exec && profile_file) {
+    struct SLv6_Profile prof;
+    init_Profile(&prof);
+    simulate_cached(&proc,&prof,NULL);
+    slv6_profile_save(&prof,profile_file);
+  } else if (sl_exec && trace_file) {
+    struct SLv6_TraceWriter tw;
+    init_TraceWriter(&tw,trace_file);
+    simulate_cached(&proc,NULL,slv6_trace_start(&tw,&proc));
+    destruct_TraceWriter(&tw);
+    mmu.trace = NULL;
+  } else if (sl_exec && cache)
+    simulate_cached(&proc,NULL,NULL);
+  else if (sl_exec)
+    simulate(&proc);
   else {
     if (arm32)
       test_decode_arm(&proc,&elf);
@@ -195,6 +836,8 @@ int main(int argc, const char *argv[]) {
     else
       test_decode(&proc,&elf);
   }
+  if (save_file)
+    slv6_save_checkpoint(&proc,save_file);
   /* check result */
   if (show_r0)
     printf("r0 = %d\n",reg(&proc,0));
@@ -204,10 +847,14 @@ int main(int argc, const char *argv[]) {
     else
       printf("Error: r0 contains %d instead of %d.\n",reg(&proc,0),expected_r0);
     destruct_Processor(&proc);
-    ef_destruct_ElfFile(&elf);
+    if (elf_ptr) ef_destruct_ElfFile(&elf);
+    if (mmu.bc) destruct_BlockCache(mmu.bc);
+    if (mmu.dc) destruct_DecodeCache(mmu.dc);
     return 4;
   }
-  ef_destruct_ElfFile(&elf);
+  if (elf_ptr) ef_destruct_ElfFile(&elf);
   destruct_Processor(&proc);
+  if (mmu.bc) destruct_BlockCache(mmu.bc);
+  if (mmu.dc) destruct_DecodeCache(mmu.dc);
   return 0;
 }
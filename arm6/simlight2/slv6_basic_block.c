@@ -0,0 +1,128 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Basic blocks of decoded instructions */
+
+#include "slv6_basic_block.h"
+#include <string.h>
+
+BEGIN_SIMSOC_NAMESPACE
+
+void init_BlockCache(struct SLv6_BlockCache *bc, struct SLv6_DecodeCache *dc) {
+  bc->dc = dc;
+  bc->pages = (struct SLv6_BlockPage**)
+    calloc(SLV6_DC_PAGE_COUNT,sizeof(struct SLv6_BlockPage*));
+  bc->all_pages = NULL;
+  bc->all_blocks = NULL;
+  bc->flush_pending = false;
+  bc->block_count = 0;
+  bc->flush_count = 0;
+}
+
+void slv6_bc_flush(struct SLv6_BlockCache *bc) {
+  while (bc->all_blocks) {
+    struct SLv6_BasicBlock *bb = bc->all_blocks;
+    bc->all_blocks = bb->all_next;
+    free(bb->instrs);
+    free(bb);
+  }
+  while (bc->all_pages) {
+    struct SLv6_BlockPage *p = bc->all_pages;
+    bc->all_pages = p->all_next;
+    bc->pages[p->index] = NULL;
+    free(p);
+  }
+  bc->flush_pending = false;
+  ++bc->flush_count;
+}
+
+void destruct_BlockCache(struct SLv6_BlockCache *bc) {
+  slv6_bc_flush(bc);
+  free(bc->pages);
+}
+
+static struct SLv6_BlockPage *get_block_page(struct SLv6_BlockCache *bc, uint32_t addr) {
+  const uint32_t index = addr>>SLV6_DC_PAGE_BITS;
+  struct SLv6_BlockPage *p = bc->pages[index];
+  if (!p) {
+    p = (struct SLv6_BlockPage*) calloc(1,sizeof(struct SLv6_BlockPage));
+    p->index = index;
+    p->all_next = bc->all_pages;
+    bc->all_pages = bc->pages[index] = p;
+  }
+  return p;
+}
+
+/* The flags N, Z, C and V are live at the end of a block. Going
+ * backward, an instruction whose flags are all dead (i.e., set again
+ * before being read) is replaced by its variant that does not set
+ * them, if simgen has generated one (see no_flags_variants in
+ * simgen/sl2_patch.ml). */
+static void remove_dead_flags(struct SLv6_Instruction *instrs, uint32_t n) {
+  uint8_t live = SLV6_FLAGS_NZCV;
+  uint16_t id, nf_id;
+  struct SLv6_Instruction *instr = instrs+n;
+  while (instr!=instrs) {
+    --instr;
+    id = instr->args.g0.id;
+    if (id<SLV6_INSTRUCTION_COUNT && !(slv6_flags_assigned[id]&live)) {
+      nf_id = slv6_no_flags_id[id];
+      if (nf_id!=id) {
+        DEBUG(printf("dead flags: %s -> %s\n",slv6_instruction_names[id],
+                     slv6_instruction_names[nf_id]));
+        instr->args.g0.id = nf_id;
+        instr->sem_fct = slv6_instruction_functions[nf_id];
+      }
+    }
+    live = (live&~slv6_flags_written(instr)) | slv6_flags_read(instr);
+  }
+}
+
+struct SLv6_BasicBlock *slv6_bb_translate(struct SLv6_BlockCache *bc, SLv6_MMU *mmu,
+                                          uint32_t addr, bool thumb) {
+  struct SLv6_Instruction instrs[SLV6_BB_MAX_SIZE+1];
+  struct SLv6_Instruction *instr;
+  struct SLv6_BlockPage *p = get_block_page(bc,addr);
+  const uint32_t size = thumb ? 2 : 4;
+  uint32_t n = 0, a = addr, w, alloc_size;
+  do {
+    if (thumb)
+      instr = slv6_dc_thumb_lookup(bc->dc,mmu,a);
+    else
+      instr = slv6_dc_arm_lookup(bc->dc,mmu,a);
+    instrs[n++] = *instr;
+    w = SLV6_DC_OFFSET(a)>>2;
+    p->code[w>>3] |= 1<<(w&7);
+    a += size;
+  } while (!may_branch(instr) && n<SLV6_BB_MAX_SIZE && SLV6_DC_OFFSET(a)!=0);
+  DEBUG(printf("new basic block: %x, %d instructions\n",addr,n));
+  remove_dead_flags(instrs,n);
+#ifdef SLV6_THREADED
+  for (w = 0; w<n; ++w)
+    instrs[w].label = slv6_threaded_label(instrs[w].args.g0.id);
+  instrs[n].label = slv6_threaded_label(SLV6_THREADED_END_ID);
+  alloc_size = (n+1)*sizeof(struct SLv6_Instruction);
+#else
+  alloc_size = n*sizeof(struct SLv6_Instruction);
+#endif
+  struct SLv6_BasicBlock *bb =
+    (struct SLv6_BasicBlock*) malloc(sizeof(struct SLv6_BasicBlock));
+  bb->start = addr;
+  bb->size = n;
+  bb->thumb = thumb;
+  bb->instrs = (struct SLv6_Instruction*) malloc(alloc_size);
+  memcpy(bb->instrs,instrs,alloc_size);
+  bb->fall_through = bb->taken = NULL;
+#ifdef SLV6_JIT
+  bb->exec_count = 0;
+  bb->native = NULL;
+#endif
+  bb->all_next = bc->all_blocks;
+  bc->all_blocks = bb;
+  if (thumb) p->thumb[SLV6_DC_OFFSET(addr)>>1] = bb;
+  else p->arm[SLV6_DC_OFFSET(addr)>>2] = bb;
+  ++bc->block_count;
+  return bb;
+}
+
+END_SIMSOC_NAMESPACE
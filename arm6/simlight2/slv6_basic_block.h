@@ -0,0 +1,157 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Basic blocks of decoded instructions */
+
+/* A basic block is a sequence of decoded instructions, taken from the
+ * decode cache. It ends with the first instruction that may branch (see
+ * may_branch), with the last instruction of a page, or after
+ * SLV6_BB_MAX_SIZE instructions. Hence, only the last instruction of a
+ * block may set proc->jump, and the other ones just increment the PC.
+ *
+ * If the ISS is generated with a direct-threaded interpreter (simgen
+ * option -oc4dt-threaded), each block is terminated by an end marker, and
+ * the semantics functions are replaced by labels.
+ *
+ * When a block is translated, an instruction setting flags that are
+ * set again before being read in the same block is replaced by a variant
+ * that does not set them, if simgen has generated one (only for hot
+ * instructions, see no_flags_variants in simgen/sl2_patch.ml). All the
+ * flags are assumed to be live at the end of a block.
+ *
+ * Blocks are chained: each block remembers the block executed after it,
+ * both when its last instruction jumps and when it does not.
+ *
+ * If simlight is built with the LLVM JIT (see slv6_jit.h), hot blocks are
+ * translated to native code.
+ *
+ * A write to a word covered by a block requests a flush of all the blocks
+ * (this also discards the chaining pointers). The flush happens at the
+ * end of the current block, so a block cannot modify its own
+ * instructions. */
+
+#ifndef SLV6_BASIC_BLOCK_H
+#define SLV6_BASIC_BLOCK_H
+
+#include "common.h"
+#include "slv6_processor.h"
+#include "slv6_decode_cache.h"
+#ifdef SLV6_JIT
+#include "slv6_jit.h"
+#endif
+
+BEGIN_SIMSOC_NAMESPACE
+
+#define SLV6_BB_MAX_SIZE 64
+
+struct SLv6_BasicBlock {
+  uint32_t start; /* address of the first instruction */
+  uint32_t size; /* number of instructions */
+  bool thumb;
+  struct SLv6_Instruction *instrs;
+  struct SLv6_BasicBlock *fall_through; /* next block if no jump */
+  struct SLv6_BasicBlock *taken; /* last block jumped to */
+  struct SLv6_BasicBlock *all_next; /* list of all blocks */
+#ifdef SLV6_JIT
+  uint32_t exec_count; /* number of executions, up to SLV6_JIT_THRESHOLD */
+  SLv6_NativeBlock native; /* NULL if not translated */
+#endif
+};
+
+struct SLv6_BlockPage {
+  struct SLv6_BasicBlock *arm[SLV6_DC_PAGE_SIZE/4];
+  struct SLv6_BasicBlock *thumb[SLV6_DC_PAGE_SIZE/2];
+  uint8_t code[SLV6_DC_PAGE_SIZE/32]; /* 1 bit per word covered by a block */
+  uint32_t index;
+  struct SLv6_BlockPage *all_next; /* list of all pages */
+};
+
+struct SLv6_BlockCache {
+  struct SLv6_DecodeCache *dc;
+  struct SLv6_BlockPage **pages; /* SLV6_DC_PAGE_COUNT pointers */
+  struct SLv6_BlockPage *all_pages;
+  struct SLv6_BasicBlock *all_blocks;
+  bool flush_pending;
+  uint32_t block_count; /* number of translated blocks */
+  uint32_t flush_count;
+};
+
+extern void init_BlockCache(struct SLv6_BlockCache*, struct SLv6_DecodeCache*);
+extern void destruct_BlockCache(struct SLv6_BlockCache*);
+
+/* discard all blocks */
+extern void slv6_bc_flush(struct SLv6_BlockCache*);
+
+/* build the block starting at address addr */
+extern struct SLv6_BasicBlock *slv6_bb_translate(struct SLv6_BlockCache*, SLv6_MMU*,
+                                                 uint32_t addr, bool thumb);
+
+/* return the block starting at the current instruction, building it if needed */
+static inline struct SLv6_BasicBlock *slv6_bb_lookup(struct SLv6_BlockCache *bc,
+                                                     struct SLv6_Processor *proc) {
+  const uint32_t addr = address_of_current_instruction(proc);
+  const bool thumb = proc->cpsr.T_flag;
+  struct SLv6_BlockPage *p = bc->pages[addr>>SLV6_DC_PAGE_BITS];
+  if (p) {
+    struct SLv6_BasicBlock *bb = thumb ?
+      p->thumb[SLV6_DC_OFFSET(addr)>>1] : p->arm[SLV6_DC_OFFSET(addr)>>2];
+    if (bb) return bb;
+  }
+  return slv6_bb_translate(bc,proc->mmu_ptr,addr,thumb);
+}
+
+/* return the block to execute after bb, and chain it to bb */
+static inline struct SLv6_BasicBlock *slv6_bb_next(struct SLv6_BlockCache *bc,
+                                                   struct SLv6_Processor *proc,
+                                                   struct SLv6_BasicBlock *bb) {
+  const uint32_t addr = address_of_current_instruction(proc);
+  const bool thumb = proc->cpsr.T_flag;
+  const bool jump = thumb!=bb->thumb || addr!=bb->start+bb->size*(thumb ? 2 : 4);
+  struct SLv6_BasicBlock *next = jump ? bb->taken : bb->fall_through;
+  if (next && next->start==addr && next->thumb==thumb)
+    return next;
+  next = slv6_bb_lookup(bc,proc);
+  if (jump) bb->taken = next;
+  else bb->fall_through = next;
+  return next;
+}
+
+/* execute the instructions of a block */
+#ifdef SLV6_THREADED
+/* The semantics functions are replaced by labels (see slv6_iss_threaded.c) */
+static inline void slv6_bb_exec(struct SLv6_Processor *proc,
+                                struct SLv6_BasicBlock *bb) {
+  slv6_threaded_exec(proc,bb->instrs,bb->thumb ? 2 : 4);
+}
+#else
+static inline void slv6_bb_exec(struct SLv6_Processor *proc,
+                                struct SLv6_BasicBlock *bb) {
+  const uint32_t size = bb->thumb ? 2 : 4;
+  struct SLv6_Instruction *instr = bb->instrs;
+  struct SLv6_Instruction *const last = bb->instrs+(bb->size-1);
+  for (; instr!=last; ++instr) {
+    instr->sem_fct(proc,instr);
+    assert(!proc->jump && "unexpected jump inside a basic block");
+    proc->regs[15] += size;
+  }
+  last->sem_fct(proc,last);
+  if (proc->jump)
+    proc->jump = false;
+  else
+    proc->regs[15] += size;
+}
+#endif
+
+/* called by the MMU when the word at address addr is modified */
+static inline void slv6_bc_invalidate(struct SLv6_BlockCache *bc, uint32_t addr) {
+  struct SLv6_BlockPage *p = bc->pages[addr>>SLV6_DC_PAGE_BITS];
+  if (p) {
+    const uint32_t w = SLV6_DC_OFFSET(addr)>>2;
+    if ((p->code[w>>3]>>(w&7))&1)
+      bc->flush_pending = true;
+  }
+}
+
+END_SIMSOC_NAMESPACE
+
+#endif /* SLV6_BASIC_BLOCK_H */
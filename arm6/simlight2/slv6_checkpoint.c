@@ -0,0 +1,186 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Checkpoints: save and restore the state of the simulator */
+
+#include "slv6_checkpoint.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+BEGIN_SIMSOC_NAMESPACE
+
+#define SLV6_CKPT_MAGIC "SLv6CKPT"
+#define SLV6_CKPT_VERSION 1
+
+/* only 32-bit words, so that there is no padding */
+struct SLv6_CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t page_size;
+  uint32_t page_count; /* number of saved pages */
+  uint32_t regs[16];
+  uint32_t user_regs[7];
+  uint32_t fiq_regs[7];
+  uint32_t irq_regs[2];
+  uint32_t svc_regs[2];
+  uint32_t abt_regs[2];
+  uint32_t und_regs[2];
+  uint32_t cpsr;
+  uint32_t spsrs[5];
+  uint32_t irq_line;
+  uint32_t fiq_line;
+  uint32_t exclusive_local;
+  uint32_t cp15_ee_bit;
+  uint32_t cp15_u_bit;
+  uint32_t cp15_v_bit;
+};
+
+/* offset of the first page in the file */
+static size_t pages_offset(uint32_t page_count) {
+  const size_t size = sizeof(struct SLv6_CheckpointHeader)+page_count*sizeof(uint32_t);
+  return (size+SLV6_MEM_PAGE_SIZE-1)&~(size_t)(SLV6_MEM_PAGE_SIZE-1);
+}
+
+static bool is_zero(const uint8_t *page) {
+  uint32_t i;
+  for (i = 0; i<SLV6_MEM_PAGE_SIZE; ++i)
+    if (page[i])
+      return false;
+  return true;
+}
+
+void slv6_save_checkpoint(struct SLv6_Processor *proc, const char *filename) {
+  SLv6_MMU *mmu = proc->mmu_ptr;
+  struct SLv6_CheckpointHeader h;
+  uint32_t *page_numbers = (uint32_t*) malloc(mmu->page_count*sizeof(uint32_t));
+  uint32_t i, n = 0;
+  size_t padding;
+  bool failed;
+  /* the file is written under another name, then renamed, because the
+   * old file may be mapped by slv6_restore_checkpoint */
+  char *tmp = (char*) malloc(strlen(filename)+5);
+  FILE *f;
+  assert(!proc->jump);
+  sprintf(tmp,"%s.tmp",filename);
+  f = fopen(tmp,"wb");
+  if (!f) {
+    fprintf(stderr,"failed to open file \"%s\"\n",tmp);
+    exit(1);
+  }
+  for (i = 0; i<SLV6_MEM_PAGE_COUNT; ++i)
+    if (mmu->pages[i] && !is_zero(mmu->pages[i])) {
+      assert(n<mmu->page_count);
+      page_numbers[n++] = i;
+    }
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,SLV6_CKPT_MAGIC,8);
+  h.version = SLV6_CKPT_VERSION;
+  h.page_size = SLV6_MEM_PAGE_SIZE;
+  h.page_count = n;
+  memcpy(h.regs,proc->regs,sizeof(h.regs));
+  memcpy(h.user_regs,proc->user_regs,sizeof(h.user_regs));
+  memcpy(h.fiq_regs,proc->fiq_regs,sizeof(h.fiq_regs));
+  memcpy(h.irq_regs,proc->irq_regs,sizeof(h.irq_regs));
+  memcpy(h.svc_regs,proc->svc_regs,sizeof(h.svc_regs));
+  memcpy(h.abt_regs,proc->abt_regs,sizeof(h.abt_regs));
+  memcpy(h.und_regs,proc->und_regs,sizeof(h.und_regs));
+  h.cpsr = StatusRegister_to_uint32(&proc->cpsr);
+  for (i = 0; i<5; ++i)
+    h.spsrs[i] = StatusRegister_to_uint32(&proc->spsrs[i]);
+  h.irq_line = proc->irq_line;
+  h.fiq_line = proc->fiq_line;
+  h.exclusive_local = proc->exclusive_local;
+  h.cp15_ee_bit = proc->cp15_ptr->ee_bit;
+  h.cp15_u_bit = proc->cp15_ptr->u_bit;
+  h.cp15_v_bit = proc->cp15_ptr->v_bit;
+  fwrite(&h,sizeof(h),1,f);
+  fwrite(page_numbers,sizeof(uint32_t),n,f);
+  for (padding = pages_offset(n)-sizeof(h)-n*sizeof(uint32_t); padding; --padding)
+    fputc(0,f);
+  for (i = 0; i<n; ++i)
+    fwrite(mmu->pages[page_numbers[i]],SLV6_MEM_PAGE_SIZE,1,f);
+  failed = ferror(f);
+  if (fclose(f) || failed || rename(tmp,filename)) {
+    fprintf(stderr,"failed to write file \"%s\"\n",filename);
+    exit(1);
+  }
+  INFO(printf("checkpoint saved in \"%s\": %d pages\n",filename,n));
+  free(tmp);
+  free(page_numbers);
+}
+
+void slv6_restore_checkpoint(struct SLv6_Processor *proc, const char *filename) {
+  SLv6_MMU *mmu = proc->mmu_ptr;
+  const struct SLv6_CheckpointHeader *h;
+  const uint32_t *page_numbers;
+  uint8_t *map, *pages;
+  struct stat st;
+  uint32_t i;
+  int fd = open(filename,O_RDONLY);
+  if (fd<0 || fstat(fd,&st)) {
+    fprintf(stderr,"failed to open file \"%s\"\n",filename);
+    exit(1);
+  }
+  if ((size_t) st.st_size<sizeof(struct SLv6_CheckpointHeader)) {
+    fprintf(stderr,"\"%s\" is not a checkpoint\n",filename);
+    exit(1);
+  }
+  map = (uint8_t*) mmap(NULL,st.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+  close(fd);
+  if (map==MAP_FAILED) {
+    fprintf(stderr,"failed to map file \"%s\"\n",filename);
+    exit(1);
+  }
+  h = (const struct SLv6_CheckpointHeader*) map;
+  if (memcmp(h->magic,SLV6_CKPT_MAGIC,8) || h->version!=SLV6_CKPT_VERSION ||
+      h->page_size!=SLV6_MEM_PAGE_SIZE ||
+      (size_t) st.st_size!=pages_offset(h->page_count)+h->page_count*(size_t)SLV6_MEM_PAGE_SIZE) {
+    fprintf(stderr,"\"%s\" is not a checkpoint of this simulator\n",filename);
+    exit(1);
+  }
+  /* the page numbers must be valid and strictly increasing, as written
+   * by slv6_save_checkpoint */
+  page_numbers = (const uint32_t*) (h+1);
+  for (i = 0; i<h->page_count; ++i)
+    if (page_numbers[i]>=SLV6_MEM_PAGE_COUNT ||
+        (i>0 && page_numbers[i]<=page_numbers[i-1])) {
+      fprintf(stderr,"\"%s\" is a corrupted checkpoint\n",filename);
+      exit(1);
+    }
+  assert(mmu->owner && mmu->page_count==0 && !mmu->mapped);
+  /* the memory */
+  pages = map+pages_offset(h->page_count);
+  for (i = 0; i<h->page_count; ++i)
+    mmu->pages[page_numbers[i]] = pages+i*SLV6_MEM_PAGE_SIZE;
+  mmu->page_count = h->page_count;
+  mmu->mapped = map;
+  mmu->mapped_size = st.st_size;
+  /* the registers; the banked registers are restored directly, so the
+   * mode is changed without set_cpsr_mode */
+  memcpy(proc->regs,h->regs,sizeof(h->regs));
+  memcpy(proc->user_regs,h->user_regs,sizeof(h->user_regs));
+  memcpy(proc->fiq_regs,h->fiq_regs,sizeof(h->fiq_regs));
+  memcpy(proc->irq_regs,h->irq_regs,sizeof(h->irq_regs));
+  memcpy(proc->svc_regs,h->svc_regs,sizeof(h->svc_regs));
+  memcpy(proc->abt_regs,h->abt_regs,sizeof(h->abt_regs));
+  memcpy(proc->und_regs,h->und_regs,sizeof(h->und_regs));
+  set_StatusRegister(&proc->cpsr,h->cpsr);
+  for (i = 0; i<5; ++i)
+    set_StatusRegister(&proc->spsrs[i],h->spsrs[i]);
+  mmu->user_mode = proc->cpsr.mode==usr;
+  proc->jump = false;
+  proc->irq_line = h->irq_line;
+  proc->fiq_line = h->fiq_line;
+  update_pending_flags(proc);
+  proc->exclusive_local = h->exclusive_local;
+  proc->cp15_ptr->ee_bit = h->cp15_ee_bit;
+  proc->cp15_ptr->u_bit = h->cp15_u_bit;
+  proc->cp15_ptr->v_bit = h->cp15_v_bit;
+  INFO(printf("checkpoint restored from \"%s\": %d pages\n",filename,h->page_count));
+}
+
+END_SIMSOC_NAMESPACE
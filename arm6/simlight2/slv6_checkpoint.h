@@ -0,0 +1,41 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Checkpoints: save and restore the state of the simulator */
+
+/* A checkpoint contains the registers of the processor (including the
+ * banked registers and the SPSRs), the state of the CP15, and the
+ * memory pages which have been allocated and are not filled with 0.
+ * The state of the devices and of the caches is not saved: simlight
+ * rejects -save and -restore with -dev.
+ *
+ * The file starts with a header (see slv6_checkpoint.c) and the list
+ * of the saved page numbers, followed by the pages, aligned on
+ * SLV6_MEM_PAGE_SIZE bytes in the file. The status registers are saved
+ * in their binary representation, so that a checkpoint does not depend
+ * on the layout of SLv6_StatusRegister. The words are stored in the
+ * byte order of the host.
+ *
+ * The restoration maps the file in memory (private mapping): the pages
+ * are read only when they are accessed, and copied only when they are
+ * written; the file itself is never modified. */
+
+#ifndef SLV6_CHECKPOINT_H
+#define SLV6_CHECKPOINT_H
+
+#include "common.h"
+#include "slv6_processor.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+/* save the state of proc, of its CP15 and of its memory; proc must be
+ * between two instructions (proc->jump is false) */
+extern void slv6_save_checkpoint(struct SLv6_Processor *proc, const char *filename);
+
+/* restore the state saved by slv6_save_checkpoint; proc must be
+ * initialized, and its memory must be empty */
+extern void slv6_restore_checkpoint(struct SLv6_Processor *proc, const char *filename);
+
+END_SIMSOC_NAMESPACE
+
+#endif /* SLV6_CHECKPOINT_H */
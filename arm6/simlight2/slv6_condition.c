@@ -28,6 +28,27 @@ const char *condition2string(SLv6_Condition cond) {
   abort();
 }
 
+#ifdef SLV6_PACKED_CPSR
+const uint16_t slv6_condition_table[16] = {
+  0xf0f0, /* EQ: Z */
+  0x0f0f, /* NE: !Z */
+  0xcccc, /* CS/HS: C */
+  0x3333, /* CC/LO: !C */
+  0xff00, /* MI: N */
+  0x00ff, /* PL: !N */
+  0xaaaa, /* VS: V */
+  0x5555, /* VC: !V */
+  0x0c0c, /* HI: C && !Z */
+  0xf3f3, /* LS: !C || Z */
+  0xaa55, /* GE: N == V */
+  0x55aa, /* LT: N != V */
+  0x0a05, /* GT: !Z && N == V */
+  0xf5fa, /* LE: Z || N != V */
+  0xffff, /* AL */
+  0x0000  /* not a condition */
+};
+#endif
+
 void slv6_print_cond(FILE *f, SLv6_Condition cond) {
   fprintf(f,"%s",condition2string(cond));
 }
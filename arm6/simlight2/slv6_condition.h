@@ -21,6 +21,17 @@ extern const char *condition2string(SLv6_Condition);
 
 struct SLv6_StatusRegister;
 
+#ifdef SLV6_PACKED_CPSR
+/* bit i of slv6_condition_table[cond] is 1 if cond holds when the flags
+ * NZCV are equal to i */
+extern const uint16_t slv6_condition_table[16];
+
+static inline bool ConditionPassed(struct SLv6_StatusRegister *sr, SLv6_Condition cond) {
+  assert(cond<=SLV6_AL && "invalid cond");
+  slv6_flags_update(sr);
+  return (slv6_condition_table[cond]>>(sr->nzcv>>28))&1;
+}
+#else
 static inline bool ConditionPassed(struct SLv6_StatusRegister *sr, SLv6_Condition cond) {
   switch (cond) {
   case SLV6_EQ: return sr->Z_flag;
@@ -41,6 +52,7 @@ static inline bool ConditionPassed(struct SLv6_StatusRegister *sr, SLv6_Conditio
   }
   assert(false && "invalid cond"); abort();
 }
+#endif
 
 extern void slv6_print_cond(FILE *f, SLv6_Condition c);
 
@@ -0,0 +1,76 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Cache of decoded instructions */
+
+#include "slv6_decode_cache.h"
+#include <string.h>
+
+BEGIN_SIMSOC_NAMESPACE
+
+void init_DecodeCache(struct SLv6_DecodeCache *dc) {
+  dc->pages = (struct SLv6_DecodeCachePage**)
+    calloc(SLV6_DC_PAGE_COUNT,sizeof(struct SLv6_DecodeCachePage*));
+  dc->decode_count = 0;
+}
+
+void destruct_DecodeCache(struct SLv6_DecodeCache *dc) {
+  uint32_t i;
+  for (i = 0; i<SLV6_DC_PAGE_COUNT; ++i)
+    free(dc->pages[i]);
+  free(dc->pages);
+}
+
+void slv6_dc_clear(struct SLv6_DecodeCache *dc) {
+  uint32_t i;
+  for (i = 0; i<SLV6_DC_PAGE_COUNT; ++i)
+    if (dc->pages[i])
+      memset(dc->pages[i],0,sizeof(struct SLv6_DecodeCachePage));
+}
+
+static struct SLv6_DecodeCachePage *get_page(struct SLv6_DecodeCache *dc,
+                                             SLv6_MMU *mmu, uint32_t addr) {
+  struct SLv6_DecodeCachePage **p = &dc->pages[addr>>SLV6_DC_PAGE_BITS];
+  if (!*p) {
+    /* the other cores read this pointer (see cache_for_write and
+     * invalidate_code in arm_mmu.c), so it is set before evicting their
+     * write caches and before reading the instruction */
+    SLV6_ATOMIC_STORE(p,(struct SLv6_DecodeCachePage*)
+                      calloc(1,sizeof(struct SLv6_DecodeCachePage)),SEQ_CST);
+    slv6_mem_code_page(mmu,addr);
+  }
+  return *p;
+}
+
+static void undef_or_unpred(struct SLv6_Processor *proc,
+                            struct SLv6_Instruction *instr) {
+  TODO("Unpredictable or undefined instruction");
+}
+
+static void set_sem_fct(struct SLv6_Instruction *instr) {
+  instr->sem_fct = slv6_instruction_functions[instr->args.g0.id];
+  if (!instr->sem_fct)
+    instr->sem_fct = undef_or_unpred;
+}
+
+struct SLv6_Instruction *slv6_dc_arm_decode(struct SLv6_DecodeCache *dc,
+                                            SLv6_MMU *mmu, uint32_t addr) {
+  struct SLv6_Instruction *instr =
+    &get_page(dc,mmu,addr)->arm[SLV6_DC_OFFSET(addr)>>2];
+  arm_decode_and_store(instr,slv6_read_word(mmu,addr));
+  set_sem_fct(instr);
+  ++dc->decode_count;
+  return instr;
+}
+
+struct SLv6_Instruction *slv6_dc_thumb_decode(struct SLv6_DecodeCache *dc,
+                                              SLv6_MMU *mmu, uint32_t addr) {
+  struct SLv6_Instruction *instr =
+    &get_page(dc,mmu,addr)->thumb[SLV6_DC_OFFSET(addr)>>1];
+  thumb_decode_and_store(instr,slv6_read_half(mmu,addr));
+  set_sem_fct(instr);
+  ++dc->decode_count;
+  return instr;
+}
+
+END_SIMSOC_NAMESPACE
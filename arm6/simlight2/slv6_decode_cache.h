@@ -0,0 +1,97 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Cache of decoded instructions */
+
+/* Each instruction is decoded once by arm_decode_and_store or
+ * thumb_decode_and_store, and the result is stored in the cache.
+ * The next executions call directly the semantics function (sem_fct).
+ *
+ * The cache covers the whole 32-bit address space. It is split into
+ * pages, which are allocated the first time an instruction of the page
+ * is decoded. A page contains one entry per ARM32 instruction and one
+ * entry per Thumb instruction. An entry whose sem_fct is NULL is not
+ * decoded yet.
+ *
+ * The MMU calls slv6_dc_invalidate on each write, so that a modified
+ * instruction is decoded again. In a multi-core simulation, the cache is
+ * only accessed by the thread of its core (see slv6_drain_code_writes). */
+
+#ifndef SLV6_DECODE_CACHE_H
+#define SLV6_DECODE_CACHE_H
+
+#include "common.h"
+#include "arm_mmu.h"
+#include "slv6_iss.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+/* the pages of the decode cache and of the memory must have the same
+ * size (see slv6_mem_code_page; checked in arm_mmu.c) */
+#define SLV6_DC_PAGE_BITS SLV6_MEM_PAGE_BITS
+#define SLV6_DC_PAGE_SIZE (1u<<SLV6_DC_PAGE_BITS)
+#define SLV6_DC_PAGE_COUNT (1u<<(32-SLV6_DC_PAGE_BITS))
+#define SLV6_DC_OFFSET(addr) ((addr)&(SLV6_DC_PAGE_SIZE-1))
+
+struct SLv6_DecodeCachePage {
+  struct SLv6_Instruction arm[SLV6_DC_PAGE_SIZE/4];
+  struct SLv6_Instruction thumb[SLV6_DC_PAGE_SIZE/2];
+};
+
+struct SLv6_DecodeCache {
+  struct SLv6_DecodeCachePage **pages; /* SLV6_DC_PAGE_COUNT pointers */
+  uint32_t decode_count; /* number of calls to the decoders */
+};
+
+extern void init_DecodeCache(struct SLv6_DecodeCache*);
+extern void destruct_DecodeCache(struct SLv6_DecodeCache*);
+
+/* decode the instruction at address addr, and store it in the cache */
+extern struct SLv6_Instruction *slv6_dc_arm_decode(struct SLv6_DecodeCache*,
+                                                   SLv6_MMU*, uint32_t addr);
+extern struct SLv6_Instruction *slv6_dc_thumb_decode(struct SLv6_DecodeCache*,
+                                                     SLv6_MMU*, uint32_t addr);
+
+/* return the decoded instruction at address addr, decoding it if needed */
+static inline struct SLv6_Instruction *
+slv6_dc_arm_lookup(struct SLv6_DecodeCache *dc, SLv6_MMU *mmu, uint32_t addr) {
+  struct SLv6_DecodeCachePage *p = dc->pages[addr>>SLV6_DC_PAGE_BITS];
+  if (p) {
+    struct SLv6_Instruction *instr = &p->arm[SLV6_DC_OFFSET(addr)>>2];
+    if (instr->sem_fct) return instr;
+  }
+  return slv6_dc_arm_decode(dc,mmu,addr);
+}
+
+static inline struct SLv6_Instruction *
+slv6_dc_thumb_lookup(struct SLv6_DecodeCache *dc, SLv6_MMU *mmu, uint32_t addr) {
+  struct SLv6_DecodeCachePage *p = dc->pages[addr>>SLV6_DC_PAGE_BITS];
+  if (p) {
+    struct SLv6_Instruction *instr = &p->thumb[SLV6_DC_OFFSET(addr)>>1];
+    if (instr->sem_fct) return instr;
+  }
+  return slv6_dc_thumb_decode(dc,mmu,addr);
+}
+
+/* clear all the entries; the pages are not freed, because the other cores
+ * read the page table (see invalidate_code in arm_mmu.c) */
+extern void slv6_dc_clear(struct SLv6_DecodeCache*);
+
+/* The bytes in [addr, addr+size) have been modified. The write is aligned
+ * and size is 1, 2, or 4. The entries are only cleared, not freed, because
+ * the instruction being executed may be one of them. */
+static inline void slv6_dc_invalidate(struct SLv6_DecodeCache *dc,
+                                      uint32_t addr, uint32_t size) {
+  struct SLv6_DecodeCachePage *p = dc->pages[addr>>SLV6_DC_PAGE_BITS];
+  if (p) {
+    const uint32_t offset = SLV6_DC_OFFSET(addr);
+    p->arm[offset>>2].sem_fct = NULL;
+    p->thumb[offset>>1].sem_fct = NULL;
+    if (size==4)
+      p->thumb[(offset>>1)+1].sem_fct = NULL;
+  }
+}
+
+END_SIMSOC_NAMESPACE
+
+#endif /* SLV6_DECODE_CACHE_H */
@@ -11,9 +11,18 @@
 #include "slv6_iss_expanded.h"
 #include "slv6_iss_grouped.h"
 #include "arm_not_implemented.h"
+#ifdef SLV6_THUMB_TABLE
+#include <pthread.h>
+#endif
 
 BEGIN_SIMSOC_NAMESPACE
 
+#ifdef SLV6_THUMB_TABLE
+/* the decoded Thumb instructions, indexed by their binary code */
+#define SLV6_THUMB_TABLE_SIZE 65536
+extern struct SLv6_Instruction slv6_thumb_table[SLV6_THUMB_TABLE_SIZE];
+#endif
+
 /* constants */
 static const uint8_t PC = 15;
 static const uint8_t LR = 14;
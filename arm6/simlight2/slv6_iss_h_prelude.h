@@ -40,4 +40,17 @@ extern void arm_decode_and_store(struct SLv6_Instruction*, uint32_t bincode);
 extern bool thumb_decode_and_exec(struct SLv6_Processor*, uint16_t bincode);
 extern void thumb_decode_and_store(struct SLv6_Instruction*, uint16_t bincode);
 
+#ifdef SLV6_THUMB_TABLE
+/* with simgen -thumb-table, the Thumb decoders read a table of the
+ * decoded Thumb instructions, which must be built before by this
+ * function (it can be called several times, by several threads) */
+extern void slv6_init_thumb_table(void);
+#endif
+
 extern bool may_branch(const struct SLv6_Instruction*);
+
+/* used by the dead flag elimination (see slv6_basic_block.c); the flags
+ * N, Z, C and V are represented by the bits 3, 2, 1 and 0 of a mask */
+#define SLV6_FLAGS_NZCV 15
+extern uint8_t slv6_flags_read(const struct SLv6_Instruction*); /* may be read */
+extern uint8_t slv6_flags_written(const struct SLv6_Instruction*); /* surely set */
@@ -0,0 +1,289 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Translation of hot basic blocks to native code, using LLVM */
+
+/* This file uses the ORC API of LLVM 14 (LLJIT). */
+
+extern "C" {
+#include "slv6_jit.h"
+#include "slv6_iss.h"
+}
+
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/* The code generated by simgen in slv6_iss-llvm_generator.hpp uses the
+ * IRBuilder of LLVM 2.9 (CreateCall2, CreateCall with two iterators), as
+ * SimSoC does. These calls are mapped to the current API. */
+class SLv6_IRBuilder: public IRBuilder<> {
+public:
+  explicit SLv6_IRBuilder(LLVMContext &ctx): IRBuilder<>(ctx) {}
+
+  using IRBuilder<>::CreateCall;
+
+  CallInst *CreateCall2(Function *f, Value *a1, Value *a2) {
+    return CreateCall(f,{a1,a2});
+  }
+  CallInst *CreateCall3(Function *f, Value *a1, Value *a2, Value *a3) {
+    return CreateCall(f,{a1,a2,a3});
+  }
+  CallInst *CreateCall4(Function *f, Value *a1, Value *a2, Value *a3, Value *a4) {
+    return CreateCall(f,{a1,a2,a3,a4});
+  }
+  template<typename Iterator>
+  CallInst *CreateCall(Function *f, Iterator begin, Iterator end) {
+    return CreateCall(f,ArrayRef<Value*>(begin,end));
+  }
+};
+
+class ARMv6_LLVM_Generator {
+public:
+  ARMv6_LLVM_Generator(): tsc(std::make_unique<LLVMContext>()),
+                          ctx(*tsc.getContext()), module(NULL), IRB(ctx),
+                          i8(IntegerType::get(ctx,8)),
+                          i16(IntegerType::get(ctx,16)),
+                          i32(IntegerType::get(ctx,32)),
+                          proc(NULL), block_count(0) {}
+
+  bool load(const char *bitcode_file);
+  SLv6_NativeBlock compile(SLv6_Instruction *instrs, uint32_t n, bool thumb);
+  void flush();
+  uint32_t get_block_count() const {return block_count;}
+
+private:
+  /* generated by simgen (file slv6_iss-llvm_generator.hpp) */
+  void generate_one_instruction(SLv6_Instruction &instr);
+
+  Function *generate(SLv6_Instruction *instrs, uint32_t n, bool thumb,
+                     const std::string &name);
+  void optimize(Function *f);
+
+  orc::ThreadSafeContext tsc;
+  LLVMContext &ctx;
+  std::unique_ptr<Module> semantics; /* the bitcode, copied for each block */
+  std::unique_ptr<orc::LLJIT> jit;
+  orc::ResourceTrackerSP tracker; /* owns the code of the current blocks */
+  Module *module; /* module of the block being generated */
+  SLv6_IRBuilder IRB;
+  IntegerType *i8, *i16, *i32;
+  Value *proc; /* first argument of the function being generated */
+  Function *next_fct, *end_fct; /* see slv6_jit_helpers.c */
+  FunctionType *block_type;
+  uint32_t block_count;
+};
+
+#include "slv6_iss-llvm_generator.hpp"
+
+bool ARMv6_LLVM_Generator::load(const char *bitcode_file) {
+  SMDiagnostic diag;
+  semantics = parseIRFile(bitcode_file,diag,ctx);
+  if (!semantics) {
+    fprintf(stderr,"Error: cannot load \"%s\": %s.\n",
+            bitcode_file,diag.getMessage().str().c_str());
+    return false;
+  }
+  Function *end = semantics->getFunction("slv6_jit_end");
+  if (!end || !semantics->getFunction("slv6_jit_next")) {
+    fprintf(stderr,"Error: slv6_jit_helpers.c is not linked in \"%s\".\n",
+            bitcode_file);
+    return false;
+  }
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  Expected<std::unique_ptr<orc::LLJIT> > j = orc::LLJITBuilder().create();
+  if (!j) {
+    fprintf(stderr,"Error: cannot create the LLVM JIT: %s.\n",
+            toString(j.takeError()).c_str());
+    return false;
+  }
+  jit = std::move(*j);
+  /* the inlined semantics functions call the functions of simlight (e.g.,
+   * the memory accessors), which is linked with -rdynamic */
+  orc::JITDylib &jd = jit->getMainJITDylib();
+  Expected<std::unique_ptr<orc::DynamicLibrarySearchGenerator> > g =
+    orc::DynamicLibrarySearchGenerator::GetForCurrentProcess
+    (jit->getDataLayout().getGlobalPrefix());
+  if (!g) {
+    fprintf(stderr,"Error: cannot find the symbols of simlight: %s.\n",
+            toString(g.takeError()).c_str());
+    return false;
+  }
+  jd.addGenerator(std::move(*g));
+  tracker = jd.createResourceTracker();
+  semantics->setDataLayout(jit->getDataLayout());
+  /* the native blocks take the same argument as the helpers, so that the
+   * type "struct SLv6_Processor*" is the one defined in the bitcode */
+  block_type = FunctionType::get(i32,end->getFunctionType()->getParamType(0),false);
+  return true;
+}
+
+Function *ARMv6_LLVM_Generator::generate(SLv6_Instruction *instrs, uint32_t n,
+                                         bool thumb, const std::string &name) {
+  Function *f = Function::Create(block_type,GlobalValue::ExternalLinkage,
+                                 name,module);
+  BasicBlock *entry = BasicBlock::Create(ctx,"entry",f);
+  IRB.SetInsertPoint(entry);
+  proc = f->arg_begin();
+  Value *size = ConstantInt::get(i32,thumb ? 2 : 4);
+  /* after each instruction but the last one, return the number of
+   * instructions executed if slv6_jit_next requests to stop; it returns a
+   * C bool, which is not an i1 */
+  for (uint32_t i = 0; i+1<n; ++i) {
+    generate_one_instruction(instrs[i]);
+    Value *ret = IRB.CreateCall2(next_fct,proc,size);
+    Value *stop = IRB.CreateICmpNE(ret,ConstantInt::get(ret->getType(),0));
+    BasicBlock *exit = BasicBlock::Create(ctx,"exit",f);
+    BasicBlock *next = BasicBlock::Create(ctx,"next",f);
+    IRB.CreateCondBr(stop,exit,next);
+    IRB.SetInsertPoint(exit);
+    IRB.CreateRet(ConstantInt::get(i32,i+1));
+    IRB.SetInsertPoint(next);
+  }
+  generate_one_instruction(instrs[n-1]);
+  IRB.CreateCall2(end_fct,proc,size);
+  IRB.CreateRet(ConstantInt::get(i32,n));
+  return f;
+}
+
+void ARMv6_LLVM_Generator::optimize(Function *f) {
+  /* inline the semantics functions and the helpers */
+  std::vector<CallInst*> calls;
+  for (Function::iterator b = f->begin(); b!=f->end(); ++b)
+    for (BasicBlock::iterator i = b->begin(); i!=b->end(); ++i)
+      if (CallInst *call = dyn_cast<CallInst>(&*i))
+        calls.push_back(call);
+  for (size_t i = 0; i<calls.size(); ++i) {
+    InlineFunctionInfo ifi;
+    InlineFunction(*calls[i],ifi);
+  }
+  legacy::FunctionPassManager fpm(module);
+  fpm.add(createInstructionCombiningPass());
+  fpm.add(createReassociatePass());
+  fpm.add(createGVNPass());
+  fpm.add(createDeadStoreEliminationPass());
+  fpm.add(createCFGSimplificationPass());
+  fpm.doInitialization();
+  fpm.run(*f);
+  fpm.doFinalization();
+  /* Keep only the block: the other functions become internal, so that
+   * they are removed if they are not called anymore, and do not clash
+   * with the ones of the other blocks. The global variables are the ones
+   * of simlight, which contains the same semantics files. */
+  for (Module::iterator g = module->begin(); g!=module->end(); ++g)
+    if (&*g!=f && !g->isDeclaration())
+      g->setLinkage(GlobalValue::InternalLinkage);
+  for (Module::global_iterator v = module->global_begin();
+       v!=module->global_end(); ++v)
+    if (!v->isDeclaration() && !v->hasLocalLinkage()) {
+      v->setInitializer(NULL);
+      v->setLinkage(GlobalValue::ExternalLinkage);
+    }
+  legacy::PassManager mpm;
+  mpm.add(createGlobalDCEPass());
+  mpm.run(*module);
+}
+
+SLv6_NativeBlock ARMv6_LLVM_Generator::compile(SLv6_Instruction *instrs,
+                                               uint32_t n, bool thumb) {
+  assert(n>0);
+  /* undefined or unpredictable instructions stay interpreted */
+  for (uint32_t i = 0; i<n; ++i)
+    if (instrs[i].args.g0.id==SLV6_UNPRED_OR_UNDEF_ID)
+      return NULL;
+  /* each block is compiled in its own copy of the bitcode, because the
+   * JIT takes the ownership of the modules it compiles */
+  std::unique_ptr<Module> m = CloneModule(*semantics);
+  module = m.get();
+  next_fct = module->getFunction("slv6_jit_next");
+  end_fct = module->getFunction("slv6_jit_end");
+  const std::string name = "slv6_block_"+std::to_string(block_count);
+  Function *f = generate(instrs,n,thumb,name);
+  /* not an assertion, which would be removed with NDEBUG */
+  if (verifyFunction(*f,&errs())) {
+    fprintf(stderr,"Error: invalid LLVM code for a block, which stays "
+            "interpreted.\n");
+    return NULL;
+  }
+  optimize(f);
+  if (Error err = jit->addIRModule(tracker,orc::ThreadSafeModule(std::move(m),tsc))) {
+    fprintf(stderr,"Error: cannot compile a block, which stays interpreted: %s.\n",
+            toString(std::move(err)).c_str());
+    return NULL;
+  }
+  Expected<JITEvaluatedSymbol> sym = jit->lookup(name);
+  if (!sym) {
+    fprintf(stderr,"Error: cannot compile a block, which stays interpreted: %s.\n",
+            toString(sym.takeError()).c_str());
+    return NULL;
+  }
+  ++block_count;
+  return (SLv6_NativeBlock) sym->getAddress();
+}
+
+void ARMv6_LLVM_Generator::flush() {
+  if (Error err = tracker->remove()) {
+    fprintf(stderr,"Error: cannot free the native blocks: %s.\n",
+            toString(std::move(err)).c_str());
+    exit(1);
+  }
+  tracker = jit->getMainJITDylib().createResourceTracker();
+}
+
+/* C interface */
+
+struct SLv6_Jit {
+  ARMv6_LLVM_Generator gen;
+};
+
+struct SLv6_Jit *slv6_jit_create(const char *bitcode_file) {
+  SLv6_Jit *jit = new SLv6_Jit;
+  if (!jit->gen.load(bitcode_file)) {
+    delete jit;
+    return NULL;
+  }
+  return jit;
+}
+
+void slv6_jit_destroy(struct SLv6_Jit *jit) {
+  delete jit;
+}
+
+SLv6_NativeBlock slv6_jit_compile(struct SLv6_Jit *jit,
+                                  struct SLv6_Instruction *instrs,
+                                  uint32_t n, bool thumb) {
+  return jit->gen.compile(instrs,n,thumb);
+}
+
+void slv6_jit_flush(struct SLv6_Jit *jit) {
+  jit->gen.flush();
+}
+
+uint32_t slv6_jit_block_count(struct SLv6_Jit *jit) {
+  return jit->gen.get_block_count();
+}
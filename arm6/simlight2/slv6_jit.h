@@ -0,0 +1,62 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Translation of hot basic blocks to native code, using LLVM */
+
+/* The semantics functions slv6_X_* (file slv6_iss_expanded.*.c) are
+ * compiled to LLVM bitcode (file slv6_iss.bc, see the Makefile). A block
+ * executed SLV6_JIT_THRESHOLD times is translated to an LLVM function
+ * calling these functions, using the code generated by simgen in
+ * slv6_iss-llvm_generator.hpp. The calls are inlined, then the function
+ * is optimized and compiled by the ORC JIT of LLVM (LLJIT). Cold blocks
+ * are still executed by slv6_bb_exec.
+ *
+ * The native function of a block behaves as slv6_bb_exec, except that it
+ * stops after an instruction which requests a flush of the block cache
+ * (a write to the code of a block, see slv6_bc_invalidate): the next
+ * instructions are then decoded again after the flush, instead of being
+ * executed as they were compiled. It returns the number of instructions
+ * executed.
+ *
+ * This file is compiled only if simlight is built with "make LLVM=1",
+ * which defines SLV6_JIT. The implementation (slv6_jit.cpp) is in C++,
+ * and uses LLVM 14. */
+
+#ifndef SLV6_JIT_H
+#define SLV6_JIT_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SLV6_JIT_THRESHOLD 64
+
+struct SLv6_Processor;
+struct SLv6_Instruction;
+struct SLv6_Jit;
+
+typedef uint32_t (*SLv6_NativeBlock)(struct SLv6_Processor*);
+
+/* load the bitcode file; return NULL and print an error if it fails */
+extern struct SLv6_Jit *slv6_jit_create(const char *bitcode_file);
+extern void slv6_jit_destroy(struct SLv6_Jit*);
+
+/* translate the block made of the n instructions instrs[0..n-1]; return
+ * NULL if the block cannot be translated (it is then interpreted) */
+extern SLv6_NativeBlock slv6_jit_compile(struct SLv6_Jit*,
+                                         struct SLv6_Instruction *instrs,
+                                         uint32_t n, bool thumb);
+
+/* discard all native blocks (called when the block cache is flushed) */
+extern void slv6_jit_flush(struct SLv6_Jit*);
+
+/* number of translated blocks */
+extern uint32_t slv6_jit_block_count(struct SLv6_Jit*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SLV6_JIT_H */
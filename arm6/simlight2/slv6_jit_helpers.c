@@ -0,0 +1,31 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Functions called by the native blocks (see slv6_jit.h) */
+
+/* This file is compiled to LLVM bitcode only, together with the semantics
+ * functions. The calls to these functions are inlined by the JIT. */
+
+#include "slv6_processor.h"
+#include "slv6_basic_block.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+/* after an instruction which is not the last one of the block; return
+ * true if the block must stop, because the instruction has modified the
+ * code of a block (see slv6_jit.h) */
+bool slv6_jit_next(struct SLv6_Processor *proc, uint32_t size) {
+  assert(!proc->jump && "unexpected jump inside a basic block");
+  proc->regs[15] += size;
+  return proc->mmu_ptr->bc->flush_pending;
+}
+
+/* after the last instruction of the block */
+void slv6_jit_end(struct SLv6_Processor *proc, uint32_t size) {
+  if (proc->jump)
+    proc->jump = false;
+  else
+    proc->regs[15] += size;
+}
+
+END_SIMSOC_NAMESPACE
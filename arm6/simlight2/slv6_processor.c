@@ -12,6 +12,7 @@ void init_Processor(struct SLv6_Processor *proc,
                     SLv6_SystemCoproc *sc) {
   proc->mmu_ptr = m;
   proc->cp15_ptr = sc;
+  proc->id = m->core_id;
   set_StatusRegister(&proc->cpsr,0x1df); /* = 0b111011111 = A+I+F+System */
   struct SLv6_StatusRegister *sr = proc->spsrs, *sr_end = proc->spsrs+5;
   for (; sr!=sr_end; ++sr)
@@ -26,6 +27,9 @@ void init_Processor(struct SLv6_Processor *proc,
   for (;i<16;++i)
     proc->regs[i] = 0;
   proc->jump = false;
+  proc->irq_line = proc->fiq_line = false;
+  proc->pending = 0;
+  proc->exclusive_local = 0;
 }
 
 void destruct_Processor(struct SLv6_Processor *proc) {
@@ -118,6 +122,46 @@ uint32_t *addr_of_reg_m(struct SLv6_Processor *proc, uint8_t reg_id, SLv6_Mode m
   abort();
 }
 
+/* common part of the exception entries (see ARM ARM A2.6); the caller
+ * sets the PC to the returned vector address */
+static uint32_t enter_exception(struct SLv6_Processor *proc, SLv6_Mode m,
+                                uint32_t return_address, uint32_t vector) {
+  const struct SLv6_StatusRegister old_cpsr = proc->cpsr;
+  set_cpsr_mode(proc,m);
+  proc->spsrs[m] = old_cpsr;
+  proc->regs[14] = return_address;
+  proc->cpsr.T_flag = false;
+  proc->cpsr.I_flag = true;
+  if (m==fiq)
+    proc->cpsr.F_flag = true;
+  if (m==fiq || m==irq)
+    proc->cpsr.A_flag = true;
+  proc->cpsr.E_flag = CP15_reg1_EEbit(proc->cp15_ptr);
+  update_pending_flags(proc);
+  return high_vectors_configured(proc) ? 0xffff0000|vector : vector;
+}
+
+void slv6_take_interrupt(struct SLv6_Processor *proc) {
+  /* the return address is the address of the next instruction + 4 */
+  const uint32_t lr = address_of_current_instruction(proc) + 4;
+  uint32_t vector;
+  assert(proc->pending && !proc->jump);
+  if (proc->pending&SLV6_PENDING_FIQ) {
+    DEBUG(printf("FIQ taken, return address = %x\n", lr));
+    vector = enter_exception(proc,fiq,lr,0x1c);
+  } else {
+    DEBUG(printf("IRQ taken, return address = %x\n", lr));
+    vector = enter_exception(proc,irq,lr,0x18);
+  }
+  proc->regs[15] = vector + 8;
+}
+
+void exec_undefined_instruction(struct SLv6_Processor *proc, void *null) {
+  const uint32_t lr = address_of_next_instruction(proc);
+  DEBUG(printf("undefined instruction, return address = %x\n", lr));
+  set_pc_raw_ws(proc,enter_exception(proc,und,lr,0x04),4);
+}
+
 void slv6_print_reg(FILE *f, uint8_t n) {
   assert(n<16);
   switch (n) {
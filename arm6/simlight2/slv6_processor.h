@@ -12,6 +12,7 @@
 #include "slv6_status_register.h"
 #include "arm_system_coproc.h"
 #include "arm_not_implemented.h"
+#include "arm_monitor.h"
 #include <stdio.h>
 
 BEGIN_SIMSOC_NAMESPACE
@@ -24,7 +25,7 @@ struct SLv6_Processor {
   struct ARMv6_Processor *proc_ptr; /* used only in SimSoC */
   struct SLv6_StatusRegister cpsr;
   struct SLv6_StatusRegister spsrs[5];
-  size_t id;
+  size_t id; /* index of the core (equal to mmu_ptr->core_id) */
   uint32_t regs[16];
 
   /* banked registers */
@@ -37,8 +38,23 @@ struct SLv6_Processor {
 
   /* true if last instruction modified the pc; must be cleared after each step */
   bool jump;
+
+  /* levels of the interrupt inputs (true if an interrupt is requested) */
+  bool irq_line;
+  bool fiq_line;
+  /* non-zero if an interrupt must be taken before the next instruction;
+   * recomputed by update_pending_flags when the lines or the CPSR change */
+  uint32_t pending;
+
+  /* local exclusive monitor: granule reserved by LDREX | SLV6_EXCL_RESERVED,
+   * or 0 (see arm_monitor.h for the global monitor) */
+  uint32_t exclusive_local;
 };
 
+/* bits of the field "pending" */
+#define SLV6_PENDING_FIQ 1
+#define SLV6_PENDING_IRQ 2
+
 extern void init_Processor(struct SLv6_Processor*,
                            SLv6_MMU*,
                            SLv6_SystemCoproc*);
@@ -47,6 +63,36 @@ extern void destruct_Processor(struct SLv6_Processor*);
 
 extern void set_cpsr_mode(struct SLv6_Processor*, SLv6_Mode m);
 
+static inline void update_pending_flags(struct SLv6_Processor *proc) {
+  proc->pending =
+    (proc->fiq_line && !proc->cpsr.F_flag ? SLV6_PENDING_FIQ : 0) |
+    (proc->irq_line && !proc->cpsr.I_flag ? SLV6_PENDING_IRQ : 0);
+}
+
+/* set the levels of the interrupt inputs (called by the interrupt controller) */
+static inline void slv6_set_interrupt_inputs(struct SLv6_Processor *proc,
+                                             bool irq, bool fiq) {
+  proc->irq_line = irq;
+  proc->fiq_line = fiq;
+  update_pending_flags(proc);
+}
+
+/* take the pending interrupt (FIQ first), i.e., enter the FIQ or IRQ mode
+ * and jump to the vector. Must be called between two instructions, if
+ * proc->pending is not zero. */
+extern void slv6_take_interrupt(struct SLv6_Processor*);
+
+/* tell if an interrupt may still be taken: the simulation does not stop
+ * at an infinite loop in this case, since the loop may be an idle loop
+ * waiting for an interrupt */
+static inline bool slv6_interruptible(struct SLv6_Processor *proc) {
+  return proc->pending || slv6_may_interrupt(proc->mmu_ptr);
+}
+
+/* enter the undefined mode and jump to the vector; called by the
+ * semantics function of an instruction (the second argument is unused) */
+extern void exec_undefined_instruction(struct SLv6_Processor*, void*);
+
 static inline void set_cpsr_sr(struct SLv6_Processor *proc,
                                struct SLv6_StatusRegister sr) {
   set_cpsr_mode(proc,sr.mode);
@@ -214,6 +260,32 @@ static inline SLv6_Mode get_current_mode(const struct SLv6_Processor *proc) {
   return proc->cpsr.mode;
 }
 
+/* exclusive accesses (LDREX and STREX) */
+
+static inline size_t ExecutingProcessor(const struct SLv6_Processor *proc) {
+  return proc->id;
+}
+
+static inline void MarkExclusiveLocal(struct SLv6_Processor *proc,
+                                      uint32_t physical_address,
+                                      size_t processor_id, uint32_t size) {
+  proc->exclusive_local = SLV6_EXCL_ADDR(physical_address)|SLV6_EXCL_RESERVED;
+}
+
+static inline bool IsExclusiveLocal(const struct SLv6_Processor *proc,
+                                    uint32_t physical_address,
+                                    size_t processor_id, uint32_t size) {
+  return proc->exclusive_local==(SLV6_EXCL_ADDR(physical_address)|SLV6_EXCL_RESERVED);
+}
+
+/* the global record of the core is cleared too */
+static inline void ClearExclusiveLocal(struct SLv6_Processor *proc,
+                                       size_t processor_id) {
+  proc->exclusive_local = 0;
+  if (proc->mmu_ptr->monitor)
+    slv6_monitor_release(proc->mmu_ptr->monitor,proc->mmu_ptr->core_id);
+}
+
 static inline void slv6_hook(struct SLv6_Processor *proc) {
   /* debug_hook(proc); */
 }
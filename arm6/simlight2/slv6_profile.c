@@ -0,0 +1,52 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Count the executions of each instruction, and write a weight file */
+
+#include "slv6_profile.h"
+#include <string.h>
+
+BEGIN_SIMSOC_NAMESPACE
+
+void init_Profile(struct SLv6_Profile *prof) {
+  memset(prof->counts,0,sizeof(prof->counts));
+}
+
+void slv6_profile_save(struct SLv6_Profile *prof, const char *filename) {
+  uint64_t weights[SLV6_WEIGHT_COUNT];
+  uint64_t w;
+  FILE *f;
+  int n = 0;
+  uint32_t i;
+  memset(weights,0,sizeof(weights));
+  /* read the previous weights, if any */
+  f = fopen(filename,"r");
+  if (f) {
+    while (fscanf(f," %" SCNu64,&w)==1) {
+      if (n==SLV6_WEIGHT_COUNT) {
+        fprintf(stderr,"\"%s\" is too long for this ISS\n",filename);
+        exit(1);
+      }
+      weights[n++] = w;
+    }
+    if (!feof(f) || n!=SLV6_WEIGHT_COUNT) {
+      fprintf(stderr,"\"%s\" is not a weight file for this ISS\n",filename);
+      exit(1);
+    }
+    fclose(f);
+  }
+  /* add the new counts */
+  for (i = 0; i<SLV6_INSTRUCTION_COUNT; ++i)
+    weights[slv6_weight_index[i]] += prof->counts[i];
+  f = fopen(filename,"w");
+  if (!f) {
+    fprintf(stderr,"failed to open file \"%s\"\n",filename);
+    exit(1);
+  }
+  for (n = 0; n<SLV6_WEIGHT_COUNT; ++n)
+    fprintf(f,"%" PRIu64 " ",weights[n]);
+  fputc('\n',f);
+  fclose(f);
+}
+
+END_SIMSOC_NAMESPACE
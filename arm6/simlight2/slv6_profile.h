@@ -0,0 +1,40 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Count the executions of each instruction, and write a weight file */
+
+/* The weight file is read by simgen (option -iwgt), and contains one
+ * number per instruction of the input program, before specialization
+ * (see get_weights in simgen/sl2_patch.ml). The count of a specialized
+ * instruction, or of a restricted variant, is added to the count of the
+ * instruction from which it is derived (see slv6_weight_index).
+ *
+ * If the weight file already exists, the new counts are added to the
+ * counts it contains. Hence, the weights of a corpus of programs can be
+ * computed by running simlight on each program with the same file. */
+
+#ifndef SLV6_PROFILE_H
+#define SLV6_PROFILE_H
+
+#include "common.h"
+#include "slv6_iss.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+struct SLv6_Profile {
+  uint64_t counts[SLV6_INSTRUCTION_COUNT+1]; /* last one: undefined instructions */
+};
+
+extern void init_Profile(struct SLv6_Profile*);
+
+static inline void slv6_profile_count(struct SLv6_Profile *prof,
+                                      struct SLv6_Instruction *instr) {
+  ++prof->counts[instr->args.g0.id];
+}
+
+/* add the counts to the weights of the file (created if needed) */
+extern void slv6_profile_save(struct SLv6_Profile*, const char *filename);
+
+END_SIMSOC_NAMESPACE
+
+#endif /* SLV6_PROFILE_H */
@@ -0,0 +1,187 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Multi-core simulation */
+
+#include "slv6_smp.h"
+#include "slv6_iss.h"
+
+BEGIN_SIMSOC_NAMESPACE
+
+void init_Smp(struct SLv6_Smp *smp, uint32_t core_count,
+              struct SLv6_Processor *proc, uint32_t quantum) {
+  SLv6_MMU *main = proc->mmu_ptr;
+  uint32_t i;
+  assert(core_count>0 && core_count<=SLV6_MAX_CORES);
+  assert(main->dc && "the cores need a decode cache");
+  smp->core_count = core_count;
+  smp->cores = (struct SLv6_Core*) calloc(core_count,sizeof(struct SLv6_Core));
+  init_ExclusiveMonitor(&smp->monitor,core_count);
+  smp->quantum = quantum;
+  pthread_mutex_init(&smp->lock,NULL);
+  pthread_cond_init(&smp->cond,NULL);
+  smp->running = smp->waiting = smp->generation = 0;
+  smp->trace_writer = NULL;
+  /* the first core */
+  main->monitor = &smp->monitor;
+  main->core_id = proc->id = 0;
+  smp->cores[0].proc = proc;
+  /* the other cores */
+  for (i = 1; i<core_count; ++i) {
+    struct SLv6_Core *core = &smp->cores[i];
+    init_shared_MMU(&core->mmu,main,&smp->monitor,i);
+    init_CP15(&core->cp15);
+    init_Processor(&core->own_proc,&core->mmu,&core->cp15);
+    init_DecodeCache(&core->dc);
+    core->mmu.dc = &core->dc;
+    if (main->bc) {
+      init_BlockCache(&core->bc,&core->dc);
+      core->mmu.bc = &core->bc;
+    }
+    core->proc = &core->own_proc;
+  }
+  for (i = 0; i<core_count; ++i)
+    smp->cores[i].smp = smp;
+#ifdef SLV6_THREADED
+  /* initialize the table of labels before starting the threads */
+  slv6_threaded_label(0);
+#endif
+}
+
+void destruct_Smp(struct SLv6_Smp *smp) {
+  uint32_t i;
+  for (i = 1; i<smp->core_count; ++i) {
+    struct SLv6_Core *core = &smp->cores[i];
+    if (core->mmu.bc) destruct_BlockCache(core->mmu.bc);
+    destruct_DecodeCache(&core->dc);
+    destruct_Processor(&core->own_proc);
+  }
+  free(smp->cores);
+  pthread_mutex_destroy(&smp->lock);
+  pthread_cond_destroy(&smp->cond);
+}
+
+/* must be called with the lock */
+static void release_waiting_cores(struct SLv6_Smp *smp) {
+  smp->waiting = 0;
+  ++smp->generation;
+  pthread_cond_broadcast(&smp->cond);
+}
+
+/* wait until all the running cores reach the end of the quantum */
+static void end_of_quantum(struct SLv6_Smp *smp) {
+  pthread_mutex_lock(&smp->lock);
+  if (++smp->waiting==smp->running)
+    release_waiting_cores(smp);
+  else {
+    const uint32_t g = smp->generation;
+    while (g==smp->generation)
+      pthread_cond_wait(&smp->cond,&smp->lock);
+  }
+  pthread_mutex_unlock(&smp->lock);
+}
+
+/* the core stops: the other cores must not wait for it anymore */
+static void stop_core(struct SLv6_Smp *smp) {
+  pthread_mutex_lock(&smp->lock);
+  --smp->running;
+  if (smp->waiting && smp->waiting==smp->running)
+    release_waiting_cores(smp);
+  pthread_mutex_unlock(&smp->lock);
+}
+
+/* execute one instruction; return true if the core has reached an
+ * infinite loop (same as simulate_cached in simlight.c) */
+static bool step_instruction(struct SLv6_Core *core) {
+  struct SLv6_Processor *proc = core->proc;
+  struct SLv6_Instruction *instr;
+  uint32_t addr;
+  slv6_drain_code_writes(proc->mmu_ptr);
+  if (proc->pending)
+    slv6_take_interrupt(proc);
+  addr = address_of_current_instruction(proc);
+  if (proc->cpsr.T_flag)
+    instr = slv6_dc_thumb_lookup(proc->mmu_ptr->dc,proc->mmu_ptr,addr);
+  else
+    instr = slv6_dc_arm_lookup(proc->mmu_ptr->dc,proc->mmu_ptr,addr);
+  if (core->trace)
+    slv6_trace_instr(core->trace,proc,addr,instr->args.g0.id);
+  instr->sem_fct(proc,instr);
+  if (proc->jump)
+    proc->jump = false;
+  else
+    increment_pc(proc);
+  if (core->trace)
+    slv6_trace_end(core->trace,proc);
+  ++core->inst_count;
+  return address_of_current_instruction(proc)==addr && !slv6_interruptible(proc);
+}
+
+/* execute one basic block (same as simulate_bb in simlight.c) */
+static bool step_block(struct SLv6_Core *core) {
+  struct SLv6_Processor *proc = core->proc;
+  struct SLv6_BlockCache *bc = proc->mmu_ptr->bc;
+  struct SLv6_BasicBlock *bb = core->bb;
+  const uint32_t last = bb->start+(bb->size-1)*(bb->thumb ? 2 : 4);
+  slv6_bb_exec(proc,bb);
+  core->inst_count += bb->size;
+  if (address_of_current_instruction(proc)==last && !slv6_interruptible(proc))
+    return true;
+  if (proc->pending)
+    slv6_take_interrupt(proc);
+  slv6_drain_code_writes(proc->mmu_ptr);
+  if (bc->flush_pending) {
+    slv6_bc_flush(bc);
+    core->bb = slv6_bb_lookup(bc,proc);
+  } else
+    core->bb = slv6_bb_next(bc,proc,bb);
+  return false;
+}
+
+static void *run_core(void *arg) {
+  struct SLv6_Core *core = (struct SLv6_Core*) arg;
+  struct SLv6_Smp *smp = core->smp;
+  uint64_t next_sync = smp->quantum;
+  bool done;
+  do {
+    done = core->bb ? step_block(core) : step_instruction(core);
+    if (smp->quantum && core->inst_count>=next_sync && !done) {
+      end_of_quantum(smp);
+      next_sync += smp->quantum;
+    }
+  } while (!done);
+  stop_core(smp);
+  return NULL;
+}
+
+void slv6_smp_run(struct SLv6_Smp *smp, uint32_t entry) {
+  uint32_t i;
+  uint64_t total = 0;
+  smp->running = smp->core_count;
+  for (i = 0; i<smp->core_count; ++i) {
+    struct SLv6_Core *core = &smp->cores[i];
+    set_pc(core->proc,entry);
+    core->proc->jump = false;
+    core->inst_count = 0;
+    core->bb = NULL;
+    core->trace = NULL;
+    if (smp->trace_writer)
+      core->trace = slv6_trace_start(smp->trace_writer,core->proc);
+    else if (core->proc->mmu_ptr->bc)
+      core->bb = slv6_bb_lookup(core->proc->mmu_ptr->bc,core->proc);
+  }
+  for (i = 0; i<smp->core_count; ++i)
+    if (pthread_create(&smp->cores[i].thread,NULL,run_core,&smp->cores[i])) {
+      fprintf(stderr,"failed to create the thread of core %d\n",i);
+      exit(1);
+    }
+  for (i = 0; i<smp->core_count; ++i) {
+    pthread_join(smp->cores[i].thread,NULL);
+    INFO(printf("Core %d reached infinite loop after %" PRIu64 " instructions executed.\n",
+                i,smp->cores[i].inst_count));
+    total += smp->cores[i].inst_count;
+  }
+  INFO(printf("%" PRIu64 " instructions executed by %d cores.\n",total,smp->core_count));
+}
+
+END_SIMSOC_NAMESPACE
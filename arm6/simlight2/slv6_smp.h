@@ -0,0 +1,86 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Multi-core simulation */
+
+/* The cores share the memory of the first core (see init_shared_MMU)
+ * and a global exclusive monitor (see arm_monitor.h). Each core has its
+ * own decode cache and block cache, which only its thread accesses. A
+ * write to an instruction decoded by other cores is posted to these
+ * cores, which invalidate it in their caches before their next
+ * instruction or block (see slv6_drain_code_writes). The memory-mapped
+ * devices are not supported.
+ *
+ * Each core runs in its own host thread, from the same entry point. A
+ * program can read the index of the core in the CPU ID register of the
+ * ARM11 MPCore (MRC p15, 0, Rd, c0, c0, 5). A core stops when it
+ * reaches an infinite loop, as in the single-core simulation (see
+ * slv6_interruptible).
+ *
+ * If the quantum is not 0, the cores synchronize every "quantum"
+ * instructions: a core which has executed n*quantum instructions waits
+ * until all the running cores have done the same. Hence, the simulated
+ * time of two cores never differ by more than one quantum. If the
+ * quantum is 0, the cores run freely. The synchronization uses a lock,
+ * but the exclusive monitor does not. */
+
+#ifndef SLV6_SMP_H
+#define SLV6_SMP_H
+
+#include "common.h"
+#include "slv6_processor.h"
+#include "slv6_decode_cache.h"
+#include "slv6_basic_block.h"
+#include "arm_monitor.h"
+#include "slv6_trace.h"
+#include <pthread.h>
+
+BEGIN_SIMSOC_NAMESPACE
+
+#define SLV6_DEFAULT_QUANTUM 1000
+
+struct SLv6_Smp;
+
+struct SLv6_Core {
+  struct SLv6_Processor *proc;
+  struct SLv6_BasicBlock *bb; /* next block to execute, if blocks are used */
+  uint64_t inst_count;
+  struct SLv6_TraceBuffer *trace; /* NULL if the core is not traced */
+  pthread_t thread;
+  struct SLv6_Smp *smp;
+  /* processor, MMU, CP15 and caches of the cores other than the first one */
+  struct SLv6_Processor own_proc;
+  SLv6_MMU mmu;
+  SLv6_SystemCoproc cp15;
+  struct SLv6_DecodeCache dc;
+  struct SLv6_BlockCache bc;
+};
+
+struct SLv6_Smp {
+  uint32_t core_count;
+  struct SLv6_Core *cores;
+  struct SLv6_ExclusiveMonitor monitor;
+  uint32_t quantum;
+  /* synchronization at the end of a quantum */
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t running; /* number of cores which have not stopped */
+  uint32_t waiting; /* number of cores waiting for the other ones */
+  uint32_t generation; /* incremented when the waiting cores are released */
+  /* if not NULL, the execution of each core is traced (without block cache) */
+  struct SLv6_TraceWriter *trace_writer;
+};
+
+/* create core_count cores; proc is the first one, and its memory
+ * contains the program. The other cores use a decode cache, and a block
+ * cache if proc->mmu_ptr has one. */
+extern void init_Smp(struct SLv6_Smp*, uint32_t core_count,
+                     struct SLv6_Processor *proc, uint32_t quantum);
+extern void destruct_Smp(struct SLv6_Smp*);
+
+/* run all the cores from entry, until they stop */
+extern void slv6_smp_run(struct SLv6_Smp*, uint32_t entry);
+
+END_SIMSOC_NAMESPACE
+
+#endif /* SLV6_SMP_H */
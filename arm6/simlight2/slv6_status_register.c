@@ -10,10 +10,14 @@ BEGIN_SIMSOC_NAMESPACE
 
 uint32_t StatusRegister_to_uint32(struct SLv6_StatusRegister *sr) {
   uint32_t x = sr->background & UnallocMask();
+#ifdef SLV6_PACKED_CPSR
+  x |= get_NZCV(sr);
+#else
   if (sr->N_flag) x |= 1<<31;
   if (sr->Z_flag) x |= 1<<30;
   if (sr->C_flag) x |= 1<<29;
   if (sr->V_flag) x |= 1<<28;
+#endif
   if (sr->Q_flag) x |= 1<<27;
   if (sr->J_flag) x |= 1<<24;
   if (sr->GE0) x |= 1<<16;
@@ -31,10 +35,17 @@ uint32_t StatusRegister_to_uint32(struct SLv6_StatusRegister *sr) {
 
 void set_StatusRegister(struct SLv6_StatusRegister *sr, uint32_t x) {
   sr->background = x & UnallocMask();
+#ifdef SLV6_PACKED_CPSR
+  sr->nzcv = x & SLV6_NZCV_MASK;
+#ifdef SLV6_LAZY_FLAGS
+  sr->lazy_op = SLV6_LAZY_NONE;
+#endif
+#else
   sr->N_flag = get_bit(x,31);
   sr->Z_flag = get_bit(x,30);
   sr->C_flag = get_bit(x,29);
   sr->V_flag = get_bit(x,28);
+#endif
   sr->Q_flag = get_bit(x,27);
   sr->J_flag = get_bit(x,24);
   sr->GE0 = get_bit(x,16);
@@ -7,10 +7,140 @@
 #define SLV6_STATUS_REGISTER_H
 
 #include "slv6_mode.h"
+#include "slv6_math.h"
 #include "common.h"
 
 BEGIN_SIMSOC_NAMESPACE
 
+/* Two layouts are available. By default, each flag is stored in a
+ * separate field. If SLV6_PACKED_CPSR is defined, the flags N, Z, C and V
+ * are packed in the field nzcv, at the same position as in the binary
+ * representation; this layout must be used with an ISS generated by
+ * "simgen -packed-cpsr" (see "make PACKED_CPSR=1"). In both cases, the
+ * flags N, Z, C and V should be accessed through the functions below. */
+
+#ifdef SLV6_PACKED_CPSR
+
+#define SLV6_N_BIT (1u<<31)
+#define SLV6_Z_BIT (1u<<30)
+#define SLV6_C_BIT (1u<<29)
+#define SLV6_V_BIT (1u<<28)
+#define SLV6_NZCV_MASK 0xf0000000
+
+/* If SLV6_LAZY_FLAGS is also defined (ISS generated by "simgen
+ * -lazy-flags", see "make LAZY_FLAGS=1"), the flag-setting additions,
+ * subtractions and logical operations do not compute the flags, but
+ * record the operation and its operands (set_lazy_flags). The flags are
+ * computed by get_NZCV when they are read. */
+#ifdef SLV6_LAZY_FLAGS
+typedef enum {
+  SLV6_LAZY_NONE, /* nzcv is up to date */
+  SLV6_LAZY_ADD, /* res = a+b */
+  SLV6_LAZY_SUB, /* res = a-b */
+  SLV6_LAZY_LOGIC /* C = a, V unchanged (i.e., in nzcv) */
+} SLv6_LazyOp;
+#endif
+
+struct SLv6_StatusRegister {
+  uint32_t nzcv; /* bits 31-28; the other bits are 0 */
+#ifdef SLV6_LAZY_FLAGS
+  uint32_t lazy_res; /* result of the last flag-setting operation */
+  uint32_t lazy_a; /* operands of the last flag-setting operation */
+  uint32_t lazy_b;
+  uint8_t lazy_op; /* an SLv6_LazyOp */
+#endif
+  bool Q_flag; /* bit 27 */
+  bool J_flag; /* bit 24 */
+  bool GE0; /* bit 16 */
+  bool GE1;
+  bool GE2;
+  bool GE3; /* bit 19 */
+  bool E_flag; /* bit 9 */
+  bool A_flag;
+  bool I_flag;
+  bool F_flag;
+  bool T_flag; /* bit 5 */
+  SLv6_Mode mode;
+  uint32_t background; /* reserved bits */
+};
+
+/* return the flags NZCV (bits 31-28) */
+static inline uint32_t get_NZCV(const struct SLv6_StatusRegister *sr) {
+#ifdef SLV6_LAZY_FLAGS
+  const uint32_t r = sr->lazy_res, a = sr->lazy_a, b = sr->lazy_b;
+  const uint32_t nz = (r&SLV6_N_BIT) | (r==0 ? SLV6_Z_BIT : 0);
+  switch (sr->lazy_op) {
+  case SLV6_LAZY_NONE:
+    return sr->nzcv;
+  case SLV6_LAZY_ADD:
+    return nz | (CarryFrom_add2(a,b) ? SLV6_C_BIT : 0)
+      | (OverflowFrom_add2(a,b) ? SLV6_V_BIT : 0);
+  case SLV6_LAZY_SUB:
+    return nz | (BorrowFrom_sub2(a,b) ? 0 : SLV6_C_BIT)
+      | (OverflowFrom_sub2(a,b) ? SLV6_V_BIT : 0);
+  case SLV6_LAZY_LOGIC:
+    return nz | (a ? SLV6_C_BIT : 0) | (sr->nzcv&SLV6_V_BIT);
+  }
+  abort(); /* unreachable */
+#else
+  return sr->nzcv;
+#endif
+}
+
+/* compute the flags recorded by set_lazy_flags, if any */
+static inline void slv6_flags_update(struct SLv6_StatusRegister *sr) {
+#ifdef SLV6_LAZY_FLAGS
+  if (sr->lazy_op!=SLV6_LAZY_NONE) {
+    sr->nzcv = get_NZCV(sr);
+    sr->lazy_op = SLV6_LAZY_NONE;
+  }
+#endif
+}
+
+#ifdef SLV6_LAZY_FLAGS
+/* record a flag-setting operation (used by the flag-setting
+ * instructions); for SLV6_LAZY_LOGIC, a is the new C flag and b is
+ * unused */
+static inline void set_lazy_flags(struct SLv6_StatusRegister *sr, SLv6_LazyOp op,
+                                  uint32_t res, uint32_t a, uint32_t b) {
+  if (op==SLV6_LAZY_LOGIC)
+    slv6_flags_update(sr); /* V is kept */
+  sr->lazy_op = op;
+  sr->lazy_res = res;
+  sr->lazy_a = a;
+  sr->lazy_b = b;
+}
+#endif
+
+#define SLV6_NZCV_ACCESSORS(F)                                          \
+  static inline bool get_##F##_flag(const struct SLv6_StatusRegister *sr) { \
+    return (get_NZCV(sr)&SLV6_##F##_BIT)!=0;                            \
+  }                                                                     \
+  static inline void set_##F##_flag(struct SLv6_StatusRegister *sr, bool b) { \
+    slv6_flags_update(sr);                                              \
+    if (b) sr->nzcv |= SLV6_##F##_BIT; else sr->nzcv &= ~SLV6_##F##_BIT; \
+  }
+
+SLV6_NZCV_ACCESSORS(N)
+SLV6_NZCV_ACCESSORS(Z)
+SLV6_NZCV_ACCESSORS(C)
+SLV6_NZCV_ACCESSORS(V)
+
+/* set the flags selected by mask to the corresponding bits of bits, with
+ * one store (used by the flag-setting instructions) */
+static inline void set_NZCV_bits(struct SLv6_StatusRegister *sr,
+                                 uint32_t mask, uint32_t bits) {
+#ifdef SLV6_LAZY_FLAGS
+  if (mask==SLV6_NZCV_MASK)
+    sr->lazy_op = SLV6_LAZY_NONE;
+  else
+    slv6_flags_update(sr);
+#endif
+  sr->nzcv = (sr->nzcv&~mask) | bits;
+}
+
+#else
+
 struct SLv6_StatusRegister {
   bool N_flag; /* bit 31 */
   bool Z_flag;
@@ -31,6 +161,21 @@ struct SLv6_StatusRegister {
   uint32_t background; /* reserved bits */
 };
 
+#define SLV6_NZCV_ACCESSORS(F)                                          \
+  static inline bool get_##F##_flag(const struct SLv6_StatusRegister *sr) { \
+    return sr->F##_flag;                                                \
+  }                                                                     \
+  static inline void set_##F##_flag(struct SLv6_StatusRegister *sr, bool b) { \
+    sr->F##_flag = b;                                                   \
+  }
+
+SLV6_NZCV_ACCESSORS(N)
+SLV6_NZCV_ACCESSORS(Z)
+SLV6_NZCV_ACCESSORS(C)
+SLV6_NZCV_ACCESSORS(V)
+
+#endif /* SLV6_PACKED_CPSR */
+
 extern uint32_t StatusRegister_to_uint32(struct SLv6_StatusRegister*);
 extern void set_StatusRegister(struct SLv6_StatusRegister*, uint32_t);
 
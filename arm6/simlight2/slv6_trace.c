@@ -0,0 +1,143 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Binary execution trace */
+
+#include "slv6_trace.h"
+#include "slv6_iss.h"
+#include <string.h>
+#include <time.h>
+
+BEGIN_SIMSOC_NAMESPACE
+
+static void write_file(struct SLv6_TraceWriter *tw, const void *data, size_t size) {
+  if (fwrite(data,1,size,tw->file)!=size) {
+    fprintf(stderr,"failed to write file \"%s\"\n",tw->filename);
+    exit(1);
+  }
+  tw->size += size;
+}
+
+/* copy the complete records of the buffers to the file; return the
+ * number of bytes copied */
+static uint64_t drain(struct SLv6_TraceWriter *tw) {
+  struct SLv6_TraceBuffer *tb;
+  uint64_t n = 0;
+  pthread_mutex_lock(&tw->lock);
+  for (tb = tw->buffers; tb; tb = tb->next) {
+    const uint64_t head = __atomic_load_n(&tb->head,__ATOMIC_ACQUIRE);
+    const uint64_t tail = tb->tail;
+    if (head!=tail) {
+      const uint32_t chunk[2] = {tb->core_id, (uint32_t) (head-tail)};
+      const uint32_t begin = tail&(SLV6_TRACE_BUFFER_SIZE-1);
+      const uint32_t end = head&(SLV6_TRACE_BUFFER_SIZE-1);
+      write_file(tw,chunk,sizeof(chunk));
+      if (begin<end)
+        write_file(tw,tb->data+begin,end-begin);
+      else {
+        write_file(tw,tb->data+begin,SLV6_TRACE_BUFFER_SIZE-begin);
+        write_file(tw,tb->data,end);
+      }
+      __atomic_store_n(&tb->tail,head,__ATOMIC_RELEASE);
+      n += head-tail;
+    }
+  }
+  pthread_mutex_unlock(&tw->lock);
+  return n;
+}
+
+static void *writer_thread(void *arg) {
+  struct SLv6_TraceWriter *tw = (struct SLv6_TraceWriter*) arg;
+  const struct timespec delay = {0, 100000}; /* 0.1 ms */
+  for (;;) {
+    /* stop is read before draining, so that the last records are written */
+    const bool stop = __atomic_load_n(&tw->stop,__ATOMIC_ACQUIRE);
+    if (!drain(tw)) {
+      if (stop)
+        return NULL;
+      nanosleep(&delay,NULL);
+    }
+  }
+}
+
+void init_TraceWriter(struct SLv6_TraceWriter *tw, const char *filename) {
+  const uint32_t header[2] = {SLV6_TRACE_VERSION, SLV6_INSTRUCTION_COUNT+1};
+  uint32_t i;
+  tw->filename = filename;
+  tw->file = fopen(filename,"wb");
+  if (!tw->file) {
+    fprintf(stderr,"failed to open file \"%s\"\n",filename);
+    exit(1);
+  }
+  tw->buffers = NULL;
+  tw->stop = false;
+  tw->size = 0;
+  write_file(tw,SLV6_TRACE_MAGIC,8);
+  write_file(tw,header,sizeof(header));
+  for (i = 0; i<=SLV6_INSTRUCTION_COUNT; ++i)
+    write_file(tw,slv6_instruction_names[i],strlen(slv6_instruction_names[i])+1);
+  pthread_mutex_init(&tw->lock,NULL);
+  if (pthread_create(&tw->thread,NULL,writer_thread,tw)) {
+    fputs("failed to create the trace thread\n",stderr);
+    exit(1);
+  }
+}
+
+void destruct_TraceWriter(struct SLv6_TraceWriter *tw) {
+  struct SLv6_TraceBuffer *tb = tw->buffers;
+  __atomic_store_n(&tw->stop,true,__ATOMIC_RELEASE);
+  pthread_join(tw->thread,NULL);
+  if (fclose(tw->file)) {
+    fprintf(stderr,"failed to write file \"%s\"\n",tw->filename);
+    exit(1);
+  }
+  INFO(printf("%" PRIu64 " bytes of trace written in \"%s\".\n",tw->size,tw->filename));
+  while (tb) {
+    struct SLv6_TraceBuffer *next = tb->next;
+    free(tb->data);
+    free(tb);
+    tb = next;
+  }
+  pthread_mutex_destroy(&tw->lock);
+}
+
+struct SLv6_TraceBuffer *slv6_trace_start(struct SLv6_TraceWriter *tw,
+                                          struct SLv6_Processor *proc) {
+  struct SLv6_TraceBuffer *tb =
+    (struct SLv6_TraceBuffer*) malloc(sizeof(struct SLv6_TraceBuffer));
+  uint32_t n;
+  tb->data = (uint8_t*) malloc(SLV6_TRACE_BUFFER_SIZE);
+  tb->head = tb->tail = tb->pos = tb->tail_cache = 0;
+  tb->core_id = proc->id;
+  tb->pc = tb->next_pc = address_of_current_instruction(proc);
+  tb->cpsr = StatusRegister_to_uint32(&proc->cpsr);
+  tb->mem_addr = 0;
+  slv6_trace_byte(tb,SLV6_TRACE_STATE);
+  slv6_trace_varint(tb,tb->pc);
+  slv6_trace_varint(tb,tb->cpsr);
+  for (n = 0; n<15; ++n) {
+    tb->regs[n] = proc->regs[n];
+    slv6_trace_varint(tb,tb->regs[n]);
+  }
+  tb->head = tb->pos;
+  proc->mmu_ptr->trace = tb;
+  /* the next writes must use the slow path, which records them */
+  for (n = 0; n<SLV6_MEM_CACHE_SIZE; ++n)
+    proc->mmu_ptr->wcache[n].page = ~0u;
+  pthread_mutex_lock(&tw->lock);
+  tb->next = tw->buffers;
+  tw->buffers = tb;
+  pthread_mutex_unlock(&tw->lock);
+  return tb;
+}
+
+void slv6_trace_wait(struct SLv6_TraceBuffer *tb) {
+  for (;;) {
+    tb->tail_cache = __atomic_load_n(&tb->tail,__ATOMIC_ACQUIRE);
+    if (SLV6_TRACE_BUFFER_SIZE-(tb->pos-tb->tail_cache)>=SLV6_TRACE_MAX_RECORDS)
+      return;
+    sched_yield();
+  }
+}
+
+END_SIMSOC_NAMESPACE
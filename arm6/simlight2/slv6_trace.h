@@ -0,0 +1,180 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Binary execution trace */
+
+/* Each simulated processor writes its trace in its own ring buffer
+ * (SLv6_TraceBuffer), without lock: the simulation thread only moves
+ * the head of the buffer, and a background thread (SLv6_TraceWriter)
+ * only moves the tail, when it copies the records to the trace file.
+ * If the buffer is full, the simulation waits for the writer.
+ *
+ * The trace file contains a header, followed by chunks. The header
+ * contains the magic string SLV6_TRACE_MAGIC, the version, the number
+ * of instruction ids, and the names of the instructions (strings
+ * terminated by '\0'). A chunk contains the id of a core and a size
+ * (two 32-bit words, in the byte order of the host), followed by the
+ * records of this core. A chunk always contains complete records.
+ *
+ * The records are delta-encoded: the first byte is a tag, and the
+ * numbers are LEB128 varints (7 bits per byte, the highest bit set if
+ * another byte follows); the signed numbers are zigzag-encoded first.
+ * - SLV6_TRACE_STATE: the pc, the CPSR, and r0-r14 (unsigned); written
+ *   when the trace of a processor starts;
+ * - SLV6_TRACE_INSTR: an instruction at the address following the
+ *   previous one; instruction id (unsigned);
+ * - SLV6_TRACE_JUMP: an instruction at another address; address minus
+ *   the address of the previous instruction (signed), instruction id;
+ * - SLV6_TRACE_REG+n (n<15): rn has been written by the last
+ *   instruction; new value minus old value (signed);
+ * - SLV6_TRACE_CPSR: the CPSR has been modified by the last
+ *   instruction; new value xor old value (unsigned);
+ * - SLV6_TRACE_MEM+s (s = 1, 2 or 4): s bytes have been written by the
+ *   last instruction; address minus the address of the previous write
+ *   (signed), value (unsigned).
+ * The pc is not recorded by SLV6_TRACE_REG: it is given by the next
+ * instruction record.
+ *
+ * Most instructions take 2 or 3 bytes: the tag and the id, plus a
+ * register write. The registers are compared after each instruction,
+ * and the memory writes are recorded by the MMU (see slv6_write_word
+ * in arm_mmu.c; the fast path of "-fast-mem" is disabled while
+ * tracing). The trace is read by trace_reader (slv6_trace_reader.c). */
+
+#ifndef SLV6_TRACE_H
+#define SLV6_TRACE_H
+
+#include "common.h"
+#include "slv6_processor.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+BEGIN_SIMSOC_NAMESPACE
+
+#define SLV6_TRACE_MAGIC "SLv6TRCE"
+#define SLV6_TRACE_VERSION 1
+
+/* tags of the records */
+#define SLV6_TRACE_STATE 0x00
+#define SLV6_TRACE_INSTR 0x01
+#define SLV6_TRACE_JUMP 0x02
+#define SLV6_TRACE_CPSR 0x03
+#define SLV6_TRACE_REG 0x10
+#define SLV6_TRACE_MEM 0x20
+
+#define SLV6_TRACE_BUFFER_SIZE (1u<<22) /* must be a power of 2 */
+/* maximal size of the records of one instruction (STM of 16 registers:
+ * 16 memory writes of at most 11 bytes, plus 16 register writes) */
+#define SLV6_TRACE_MAX_RECORDS 512
+
+struct SLv6_TraceBuffer {
+  uint8_t *data; /* SLV6_TRACE_BUFFER_SIZE bytes */
+  uint64_t head; /* end of the complete records (written by the simulation) */
+  uint64_t tail; /* end of the records written in the file (written by the writer) */
+  uint64_t pos; /* end of the current records */
+  uint64_t tail_cache; /* last value of tail read by the simulation */
+  uint32_t core_id;
+  /* state used for the delta encoding */
+  uint32_t pc; /* address of the last instruction */
+  uint32_t next_pc; /* address following the last instruction */
+  uint32_t regs[15];
+  uint32_t cpsr;
+  uint32_t mem_addr; /* address of the last memory write */
+  struct SLv6_TraceBuffer *next;
+};
+
+struct SLv6_TraceWriter {
+  FILE *file;
+  const char *filename;
+  struct SLv6_TraceBuffer *buffers;
+  pthread_mutex_t lock; /* protects the list of buffers */
+  pthread_t thread;
+  bool stop;
+  uint64_t size; /* number of bytes written */
+};
+
+/* create the file and start the background thread */
+extern void init_TraceWriter(struct SLv6_TraceWriter*, const char *filename);
+/* write the remaining records, stop the thread, close the file, and
+ * free the buffers */
+extern void destruct_TraceWriter(struct SLv6_TraceWriter*);
+
+/* start the trace of proc, from its current state; the memory writes
+ * are recorded through proc->mmu_ptr->trace */
+extern struct SLv6_TraceBuffer *slv6_trace_start(struct SLv6_TraceWriter*,
+                                                 struct SLv6_Processor *proc);
+
+/* wait until the writer has made room for the records of an instruction */
+extern void slv6_trace_wait(struct SLv6_TraceBuffer*);
+
+static inline void slv6_trace_byte(struct SLv6_TraceBuffer *tb, uint8_t b) {
+  tb->data[tb->pos++&(SLV6_TRACE_BUFFER_SIZE-1)] = b;
+}
+
+static inline void slv6_trace_varint(struct SLv6_TraceBuffer *tb, uint32_t x) {
+  while (x>=0x80) {
+    slv6_trace_byte(tb,x|0x80);
+    x >>= 7;
+  }
+  slv6_trace_byte(tb,x);
+}
+
+static inline uint32_t slv6_zigzag(int32_t x) {
+  return ((uint32_t) x<<1)^(uint32_t)(x>>31);
+}
+
+static inline int32_t slv6_unzigzag(uint32_t x) {
+  return (int32_t) (x>>1)^-(int32_t)(x&1);
+}
+
+/* called before the execution of the instruction at address addr */
+static inline void slv6_trace_instr(struct SLv6_TraceBuffer *tb,
+                                    struct SLv6_Processor *proc,
+                                    uint32_t addr, uint16_t id) {
+  if (SLV6_TRACE_BUFFER_SIZE-(tb->pos-tb->tail_cache)<SLV6_TRACE_MAX_RECORDS)
+    slv6_trace_wait(tb);
+  if (addr==tb->next_pc)
+    slv6_trace_byte(tb,SLV6_TRACE_INSTR);
+  else {
+    slv6_trace_byte(tb,SLV6_TRACE_JUMP);
+    slv6_trace_varint(tb,slv6_zigzag(addr-tb->pc));
+  }
+  slv6_trace_varint(tb,id);
+  tb->pc = addr;
+  tb->next_pc = addr+inst_size(proc);
+}
+
+/* called by the MMU */
+static inline void slv6_trace_mem(struct SLv6_TraceBuffer *tb, uint32_t addr,
+                                  uint8_t size, uint32_t data) {
+  slv6_trace_byte(tb,SLV6_TRACE_MEM+size);
+  slv6_trace_varint(tb,slv6_zigzag(addr-tb->mem_addr));
+  slv6_trace_varint(tb,data);
+  tb->mem_addr = addr;
+}
+
+/* called after the execution of an instruction: record the modified
+ * registers, and make the records visible to the writer */
+static inline void slv6_trace_end(struct SLv6_TraceBuffer *tb,
+                                  struct SLv6_Processor *proc) {
+  uint32_t cpsr;
+  uint8_t n;
+  for (n = 0; n<15; ++n)
+    if (proc->regs[n]!=tb->regs[n]) {
+      slv6_trace_byte(tb,SLV6_TRACE_REG+n);
+      slv6_trace_varint(tb,slv6_zigzag(proc->regs[n]-tb->regs[n]));
+      tb->regs[n] = proc->regs[n];
+    }
+  cpsr = StatusRegister_to_uint32(&proc->cpsr);
+  if (cpsr!=tb->cpsr) {
+    slv6_trace_byte(tb,SLV6_TRACE_CPSR);
+    slv6_trace_varint(tb,cpsr^tb->cpsr);
+    tb->cpsr = cpsr;
+  }
+  SLV6_ATOMIC_STORE(&tb->head,tb->pos,RELEASE);
+}
+
+END_SIMSOC_NAMESPACE
+
+#endif /* SLV6_TRACE_H */
@@ -0,0 +1,215 @@
+/* SimSoC-Cert, a library on processor architectures for embedded systems. */
+/* See the COPYRIGHTS and LICENSE files. */
+
+/* Reader of the binary traces written by simlight -trace (see slv6_trace.h) */
+
+#include "slv6_trace.h"
+#include <string.h>
+
+/* state of a core, rebuilt from the records */
+struct CoreState {
+  bool started;
+  uint32_t pc, next_pc;
+  uint32_t regs[15];
+  uint32_t cpsr;
+  uint32_t mem_addr;
+  uint64_t inst_count;
+};
+
+static struct CoreState cores[SLV6_MAX_CORES];
+static char **names;
+static uint32_t name_count;
+static uint64_t *counts; /* number of executions of each instruction */
+static uint64_t reg_writes, mem_writes;
+static bool stats = false;
+static bool line_started = false; /* the current line must be ended */
+
+static void error(const char *msg) {
+  fprintf(stderr,"Error: %s.\n",msg);
+  exit(1);
+}
+
+static void read_file(void *data, size_t size, FILE *f) {
+  if (fread(data,1,size,f)!=size)
+    error("truncated trace file");
+}
+
+static void read_header(FILE *f) {
+  char magic[8];
+  uint32_t header[2], i;
+  read_file(magic,8,f);
+  if (memcmp(magic,SLV6_TRACE_MAGIC,8))
+    error("not a trace file");
+  read_file(header,sizeof(header),f);
+  if (header[0]!=SLV6_TRACE_VERSION)
+    error("unsupported version of the trace format");
+  name_count = header[1];
+  names = (char**) malloc(name_count*sizeof(char*));
+  counts = (uint64_t*) calloc(name_count,sizeof(uint64_t));
+  for (i = 0; i<name_count; ++i) {
+    char buf[256];
+    size_t n = 0;
+    int c;
+    while ((c = fgetc(f))!=0) {
+      if (c==EOF || n==sizeof(buf)-1)
+        error("invalid instruction name");
+      buf[n++] = c;
+    }
+    buf[n] = 0;
+    names[i] = strdup(buf);
+  }
+}
+
+/* records of the current chunk */
+static const uint8_t *p, *end;
+
+static uint32_t varint() {
+  uint32_t x = 0;
+  int shift = 0;
+  do {
+    if (p==end || shift>28)
+      error("invalid record");
+    x |= (uint32_t) (*p&0x7f)<<shift;
+    shift += 7;
+  } while (*p++&0x80);
+  return x;
+}
+
+static const char *name(uint32_t id) {
+  if (id>=name_count)
+    error("invalid instruction id");
+  return names[id];
+}
+
+static void start_line() {
+  if (line_started)
+    putchar('\n');
+  line_started = true;
+}
+
+static void instruction(struct CoreState *s, uint32_t core, uint32_t addr, uint32_t id) {
+  const char *n = name(id);
+  if (!s->started)
+    error("instruction before the initial state");
+  s->pc = addr;
+  s->next_pc = addr+((s->cpsr>>5)&1 ? 2 : 4); /* T flag */
+  ++s->inst_count;
+  ++counts[id];
+  if (!stats) {
+    start_line();
+    printf("%d %08x %s",core,addr,n);
+  }
+}
+
+static void decode_chunk(uint32_t core) {
+  struct CoreState *s = &cores[core];
+  while (p!=end) {
+    const uint8_t tag = *p++;
+    if (tag==SLV6_TRACE_STATE) {
+      uint8_t n;
+      s->started = true;
+      s->pc = s->next_pc = varint();
+      s->cpsr = varint();
+      for (n = 0; n<15; ++n)
+        s->regs[n] = varint();
+      s->mem_addr = 0;
+      if (!stats) {
+        start_line();
+        printf("%d start at %08x, cpsr=%08x",core,s->pc,s->cpsr);
+      }
+    } else if (tag==SLV6_TRACE_INSTR) {
+      instruction(s,core,s->next_pc,varint());
+    } else if (tag==SLV6_TRACE_JUMP) {
+      const uint32_t addr = s->pc+slv6_unzigzag(varint());
+      instruction(s,core,addr,varint());
+    } else if (tag==SLV6_TRACE_CPSR) {
+      s->cpsr ^= varint();
+      if (!stats)
+        printf(" cpsr=%08x",s->cpsr);
+    } else if (tag>=SLV6_TRACE_REG && tag<SLV6_TRACE_REG+15) {
+      const uint8_t n = tag-SLV6_TRACE_REG;
+      s->regs[n] += slv6_unzigzag(varint());
+      ++reg_writes;
+      if (!stats)
+        printf(" r%d=%x",n,s->regs[n]);
+    } else if (tag==SLV6_TRACE_MEM+1 || tag==SLV6_TRACE_MEM+2 || tag==SLV6_TRACE_MEM+4) {
+      uint32_t data;
+      s->mem_addr += slv6_unzigzag(varint());
+      data = varint();
+      ++mem_writes;
+      if (!stats)
+        printf(" [%x]%s=%x",s->mem_addr,
+               tag==SLV6_TRACE_MEM+1 ? "b" : tag==SLV6_TRACE_MEM+2 ? "h" : "",data);
+    } else
+      error("invalid record");
+  }
+}
+
+static void print_stats() {
+  uint64_t total = 0;
+  uint32_t i;
+  for (i = 0; i<SLV6_MAX_CORES; ++i)
+    if (cores[i].started) {
+      printf("core %d: %" PRIu64 " instructions\n",i,cores[i].inst_count);
+      total += cores[i].inst_count;
+    }
+  printf("%" PRIu64 " instructions, %" PRIu64 " register writes, %" PRIu64
+         " memory writes\n", total, reg_writes, mem_writes);
+  for (i = 0; i<name_count; ++i)
+    if (counts[i])
+      printf("%12" PRIu64 " %s\n",counts[i],names[i]);
+}
+
+static void usage(const char *pname) {
+  puts("Reader of the binary traces written by simlight -trace.");
+  printf("Usage: %s [-s] <trace_file>\n", pname);
+  puts("\t-s   print statistics instead of the instructions");
+}
+
+int main(int argc, const char *argv[]) {
+  const char *filename = NULL;
+  uint8_t *buffer = NULL;
+  uint32_t buffer_size = 0;
+  uint32_t chunk[2];
+  FILE *f;
+  int i;
+  for (i = 1; i<argc; ++i) {
+    if (!strcmp(argv[i],"-s"))
+      stats = true;
+    else if (argv[i][0]!='-' && !filename)
+      filename = argv[i];
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!filename) {
+    usage(argv[0]);
+    return 1;
+  }
+  f = fopen(filename,"rb");
+  if (!f) {
+    fprintf(stderr,"failed to open file \"%s\"\n",filename);
+    return 1;
+  }
+  read_header(f);
+  while (fread(chunk,sizeof(chunk),1,f)==1) {
+    if (chunk[0]>=SLV6_MAX_CORES)
+      error("invalid core id");
+    if (chunk[1]>buffer_size) {
+      buffer_size = chunk[1];
+      buffer = (uint8_t*) realloc(buffer,buffer_size);
+    }
+    read_file(buffer,chunk[1],f);
+    p = buffer;
+    end = buffer+chunk[1];
+    decode_chunk(chunk[0]);
+  }
+  if (stats)
+    print_stats();
+  else if (line_started)
+    putchar('\n');
+  fclose(f);
+  free(buffer);
+  return 0;
+}
@@ -8,26 +8,7 @@ open BinPos
 open Bitvec
 open Datatypes
 
-let str_of_msg = 
-  let open Arm6_Message in
-  function
-  | EmptyMessage -> "EmptyMessage"
-  | ImpreciseDataAbort -> "ImpreciseDataAbort"
-  | InvalidInstructionSet -> "InvalidInstructionSet"
-  | JazelleInstructionSetNotImplemented -> "JazelleInstructionSetNotImplemented"
-  | ThumbInstructionSetNotImplemented -> "ThumbInstructionSetNotImplemented"
-  | DecodingReturnsUnpredictable -> "DecodingReturnsUnpredictable"
-  | StartOpcodeExecutionAt -> "StartOpcodeExecutionAt"
-  | While -> "While"
-  | Coproc -> "Coproc"
-  | Affect -> "Affect"
-  | Case -> "Case"
-  | ComplexSemantics -> "ComplexSemantics"
-  | NotAnAddressingMode1 -> "NotAnAddressingMode1"
-  | NotAnAddressingMode2 -> "NotAnAddressingMode2"
-  | NotAnAddressingMode3 -> "NotAnAddressingMode3"
-  | NotAnAddressingMode4 -> "NotAnAddressingMode4"
-  | NotAnAddressingMode5 -> "NotAnAddressingMode5";;
+let str_of_msg = Messages.str_of_msg;;
 
 module type TEST = 
 sig
@@ -40,15 +21,22 @@ module Arm_Test (Arm6_Dec : ARM6DEC) : TEST =
 struct
   type state = Arm6_State.state
 
+(* number of steps of the simulator (a binary natural number) *)
+let n_of_camlint n =
+  if n = 0_l then BinNat.N0 else BinNat.Npos (Camlcoq.positive_of_camlint n);;
+let camlint_of_n = function
+  | BinNat.N0 -> 0_l
+  | BinNat.Npos p -> Camlcoq.camlint_of_positive p;;
+
 let simul lbs = 
-  let n = Camlcoq.camlint_of_nat (Arm6_Simul.Simu.nb_next lbs) in
+  let n = camlint_of_n (Arm6_Simul.Simu.nb_next lbs) in
   Arm6_Simul.Simu.catch Arm6_Simul.S.simul (fun m lbs ->
     let num = Arm6_Simul.Simu.nb_next lbs in
-    let step = string_of_int (n - Camlcoq.camlint_of_nat num) in
+    let step = Int32.to_string (Int32.sub n (camlint_of_n num)) in
     failwith ("SimKo: " ^ str_of_msg m ^ " at step " ^ step)) lbs;;
 
 let next = 
-  Arm6_Simul.Simu.bind (fun lbs -> Arm6_Simul.Simu.SimOk ((), { lbs with Arm6_Simul.Simu.nb_next = n1 }))
+  Arm6_Simul.Simu.bind (fun lbs -> Arm6_Simul.Simu.SimOk ((), { lbs with Arm6_Simul.Simu.nb_next = BinNat.Npos Coq_xH }))
     (fun () -> simul);;
 
 let (+) = Int32.add
@@ -79,7 +67,7 @@ let stack s =
 let return a lbs = Arm6_Simul.Simu.SimOk (a, lbs)
 
 let mk_st state steps = 
-  { Arm6_Simul.Simu.semst = { Arm6_Functions.Semantics.S.loc = [] ; bo = true ; st = state } ; nb_next = Camlcoq.nat_of_camlint steps }
+  { Arm6_Simul.Simu.semst = { Arm6_Functions.Semantics.S.loc = [] ; bo = true ; st = state } ; nb_next = n_of_camlint steps }
 
 let get_st f x = f x.Arm6_Simul.Simu.semst.Arm6_Functions.Semantics.S.st x
 
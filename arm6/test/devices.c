@@ -0,0 +1,38 @@
+/*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+ */
+
+/* test the memory-mapped devices of simlight2 (option -dev)
+ * r0 should contain 0xf at the end */
+
+#include "common.h"
+
+#define INTC ((volatile uint32_t*) 0x10140000)
+#define TIMER ((volatile uint32_t*) 0x101e2000)
+#define CONSOLE ((volatile uint32_t*) 0x101f1000)
+
+int count = 0;
+
+#define CHECK(OP, TEST) \
+  if ((TEST)) count+=(OP);
+
+int main() {
+  const char *s = "hello\n";
+  /* console: the transmit FIFO is always empty */
+  CHECK(1,CONSOLE[0x18/4]&0x80);
+  while (*s)
+    CONSOLE[0] = *s++;
+  /* one-shot timer connected to the line 4 of the interrupt controller */
+  INTC[0x10/4] = 1<<4;
+  TIMER[0] = 100;
+  TIMER[0x08/4] = 0x80|0x20|0x01;
+  while (!(INTC[0]&(1<<4)));
+  CHECK(2,TIMER[0x10/4]==1);
+  TIMER[0x0c/4] = 0;
+  CHECK(4,INTC[0]==0);
+  /* software interrupt */
+  INTC[0x18/4] = 1;
+  CHECK(8,INTC[0x08/4]==1);
+  return count;
+}
@@ -0,0 +1,63 @@
+/*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+ */
+
+/* test an idle loop waiting for the IRQs of the timer of simlight2
+ * (option -dev): main returns while the timer is running, so the
+ * simulation must not stop at the infinite loop of _start before the
+ * handler disables the timer.
+ * r0 should contain 0x3 at the end */
+
+#include "common.h"
+
+#define INTC ((volatile uint32_t*) 0x10140000)
+#define TIMER ((volatile uint32_t*) 0x101e2000)
+
+volatile int ticks = 0;
+
+/* called by the handler with the r0 of the interrupted code, and
+ * returns its new value */
+int tick(int r0) {
+  TIMER[0x0c/4] = 0; /* IntClr */
+  if (++ticks==3) {
+    TIMER[0x08/4] = 0; /* stop the timer: the idle loop is the end */
+    r0 |= 2;
+  }
+  return r0;
+}
+
+void handler() __attribute__ ((naked));
+void handler() {
+  asm volatile ("sub lr, lr, #4\n\t"
+                "stmfd sp!, {r1-r3, r12, lr}\n\t"
+                "bl tick\n\t"
+                "ldmfd sp!, {r1-r3, r12, pc}^");
+}
+
+#define SET_MODE(m)                                       \
+  asm volatile ("mrs r0, CPSR\n\t"                        \
+                "bic r0, r0, #0xff\n\t"                   \
+                "orr r0, r0, #" #m "\n\t"                 \
+                "msr CPSR_c, r0": : :"r0")
+
+#define SET_IRQ_HANDLER(f)                                              \
+  *((volatile uint32_t *) (0x18+8+0x10)) = (uint32_t) f;               \
+  *((volatile uint32_t *) 0x18) = 0xe59ff010 // ldr pc, [pc, #+16]
+
+#define INIT_IRQ_STACK()                           \
+  SET_MODE(0xd2);                                  \
+  asm ("mov     sp, #0xf000");                     \
+  SET_MODE(0xdf)
+
+int main() {
+  SET_IRQ_HANDLER(handler);
+  INIT_IRQ_STACK();
+  /* periodic timer connected to the line 4 of the interrupt controller */
+  INTC[0x10/4] = 1<<4;
+  TIMER[0] = 100;
+  TIMER[0x08/4] = 0x80|0x40|0x20;
+  /* unmask the IRQs, and idle in the while(1) of _start */
+  SET_MODE(0x5f);
+  return ticks==0;
+}
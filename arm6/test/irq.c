@@ -0,0 +1,63 @@
+/*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+ */
+
+/* test the IRQs raised by the timer of simlight2 (option -dev)
+ * r0 should contain 0xf at the end */
+
+#include "common.h"
+
+#define INTC ((volatile uint32_t*) 0x10140000)
+#define TIMER ((volatile uint32_t*) 0x101e2000)
+
+int count = 0;
+volatile int ticks = 0;
+
+#define CHECK(OP, TEST) \
+  if ((TEST)) count+=(OP);
+
+void handler() __attribute__ ((interrupt("IRQ")));
+void handler() {
+  TIMER[0x0c/4] = 0; /* IntClr */
+  ++ticks;
+}
+
+#define SET_MODE(m)                                       \
+  asm volatile ("mrs r0, CPSR\n\t"                        \
+                "bic r0, r0, #0xff\n\t"                   \
+                "orr r0, r0, #" #m "\n\t"                 \
+                "msr CPSR_c, r0": : :"r0")
+
+#define SET_IRQ_HANDLER(f)                                              \
+  *((volatile uint32_t *) (0x18+8+0x10)) = (uint32_t) f;               \
+  *((volatile uint32_t *) 0x18) = 0xe59ff010 // ldr pc, [pc, #+16]
+
+#define INIT_IRQ_STACK()                           \
+  SET_MODE(0xd2);                                  \
+  asm ("mov     sp, #0xf000");                     \
+  SET_MODE(0xdf)
+
+int main() {
+  int i;
+  SET_IRQ_HANDLER(handler);
+  INIT_IRQ_STACK();
+  /* periodic timer connected to the line 4 of the interrupt controller */
+  INTC[0x10/4] = 1<<4;
+  TIMER[0] = 100;
+  TIMER[0x08/4] = 0x80|0x40|0x20;
+  /* the interrupt is masked by the I bit */
+  while (!(INTC[0]&(1<<4)));
+  CHECK(1,ticks==0);
+  /* unmask the IRQs: the pending interrupt is taken at once */
+  SET_MODE(0x5f);
+  CHECK(2,ticks==1);
+  while (ticks<3);
+  CHECK(4,ticks==3);
+  /* mask the IRQs again */
+  SET_MODE(0xdf);
+  for (i = 0; i<100; ++i);
+  TIMER[0x08/4] = 0;
+  CHECK(8,ticks==3);
+  return count;
+}
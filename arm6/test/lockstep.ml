@@ -0,0 +1,312 @@
+(*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+
+Lockstep comparison of simlight2 and of the simulator extracted from Coq.
+
+simlight2 writes a binary trace of the execution (option -trace, see
+arm6/simlight2/slv6_trace.h), from which the state of the processor
+before each instruction is rebuilt. The Coq simulator is run on the
+same program, and its state (r0-r14, the CPSR, and the address of the
+current instruction) is compared with the trace every N instructions.
+
+After a mismatch, the last N instructions are bisected to find the
+instruction after which the two simulators differ. The states of the
+Coq simulator are persistent values, so each half is simulated from
+the last state where both simulators agree: the bisection simulates at
+most N more instructions. A difference which appears and disappears
+between two comparisons is not detected.
+
+Usage: lockstep [-every N] <test> <trace file>
+where <test> is the name of an ARM test (e.g. sorting_a), and the trace
+has been written by: simlight -trace=<trace file> <test>.elf
+*)
+
+open Printf
+
+(****************************************************************************)
+(** tests available in the Coq simulator *)
+
+let tests =
+  [ "sum_iterative_a", Sum_iterative_a.initial_state
+  ; "sum_recursive_a", Sum_recursive_a.initial_state
+  ; "sum_direct_a", Sum_direct_a.initial_state
+  ; "endian_a", Endian_a.initial_state
+  ; "multiply_a", Multiply_a.initial_state
+  ; "simsoc_new1_a", Simsoc_new1_a.initial_state
+  ; "test_mem_a", Test_mem_a.initial_state
+  ; "sorting_a", Sorting_a.initial_state
+
+  ; "arm_blx2_a", Arm_blx2_a.initial_state
+  ; "arm_cflag_a", Arm_cflag_a.initial_state
+  ; "arm_dpi_a", Arm_dpi_a.initial_state
+  ; "arm_edsp_a", Arm_edsp_a.initial_state
+  ; "arm_ldmstm_a", Arm_ldmstm_a.initial_state
+  ; "arm_ldrd_strd_a", Arm_ldrd_strd_a.initial_state
+  ; "arm_ldrstr_a", Arm_ldrstr_a.initial_state
+  ; "arm_mrs_a", Arm_mrs_a.initial_state
+  ; "arm_msr_a", Arm_msr_a.initial_state
+  ; "arm_multiple_a", Arm_multiple_a.initial_state
+  ; "arm_swi_a", Arm_swi_a.initial_state
+
+  ; "arm_v6_a", Arm_v6_a.initial_state
+  ; "arm_v6_SADD_a", Arm_v6_SADD_a.initial_state
+  ; "arm_v6_QADD_a", Arm_v6_QADD_a.initial_state
+  ; "arm_v6_QSUB_a", Arm_v6_QSUB_a.initial_state
+  ; "arm_v6_REV_a", Arm_v6_REV_a.initial_state
+  ; "arm_v6_SSAT_a", Arm_v6_SSAT_a.initial_state
+  ; "arm_v6_SSUB_a", Arm_v6_SSUB_a.initial_state
+  ; "arm_v6_SXTA_a", Arm_v6_SXTA_a.initial_state
+  ; "arm_v6_SXTB_a", Arm_v6_SXTB_a.initial_state
+  ; "arm_v6_SHADD_a", Arm_v6_SHADD_a.initial_state
+  ; "arm_v6_SHSUB_a", Arm_v6_SHSUB_a.initial_state
+  ; "arm_v6_SML_a", Arm_v6_SML_a.initial_state
+  ; "arm_v6_SMM_a", Arm_v6_SMM_a.initial_state
+  ; "arm_v6_SMU_a", Arm_v6_SMU_a.initial_state
+  ; "arm_v6_UA_a", Arm_v6_UA_a.initial_state
+  ; "arm_v6_UQADD_a", Arm_v6_UQADD_a.initial_state
+  ; "arm_v6_USUB_a", Arm_v6_USUB_a.initial_state
+  ; "arm_v6_UXTA_a", Arm_v6_UXTA_a.initial_state
+  ; "arm_v6_UXTB_a", Arm_v6_UXTB_a.initial_state
+  ; "arm_v6_UMAAL_a", Arm_v6_UMAAL_a.initial_state
+  ; "arm_v6_UH_a", Arm_v6_UH_a.initial_state
+  ; "arm_v6_UQSUB_a", Arm_v6_UQSUB_a.initial_state
+  ; "arm_v6_USAD_a", Arm_v6_USAD_a.initial_state
+  ; "arm_v6_USAT_a", Arm_v6_USAT_a.initial_state ];;
+
+(****************************************************************************)
+(** states compared *)
+
+(* A state is an array: the address of the current instruction (-1 if
+   unknown), the CPSR, r0-r14, and the id of the current instruction
+   in the trace (not compared). The words are stored as non-negative
+   OCaml integers. *)
+let state_size = 18;;
+let compared = 17;;
+
+let mask = 0xffffffff;;
+
+let field_name i =
+  if i = 0 then "pc" else if i = 1 then "cpsr" else sprintf "r%d" (i-2);;
+
+let same (a : int array) (b : int array) =
+  let rec aux i = i = compared || ((a.(i) = b.(i) || (i = 0 && a.(0) = -1)) && aux (i+1)) in
+  aux 0;;
+
+(****************************************************************************)
+(** reading of the trace written by simlight2 (see slv6_trace.h) *)
+
+type trace =
+  { ic : in_channel
+  ; names : string array
+  ; mutable chunk : int (* number of bytes remaining in the current chunk *)
+  ; regs : int array (* r0-r14 *)
+  ; mutable cpsr : int
+  ; mutable pc : int (* address of the last instruction *)
+  ; mutable next_pc : int (* address following the last instruction *)
+  ; mutable id : int (* id of the last instruction *)
+  ; mutable count : int (* number of instructions read *)
+  ; mutable finished : bool };;
+
+(* 32-bit word, in the byte order of the host (little-endian) *)
+let word ic =
+  let b0 = input_byte ic in let b1 = input_byte ic in
+  let b2 = input_byte ic in let b3 = input_byte ic in
+  b0 lor (b1 lsl 8) lor (b2 lsl 16) lor (b3 lsl 24);;
+
+let open_trace filename =
+  let ic = open_in_bin filename in
+  try
+    String.iter (fun c -> if input_byte ic <> Char.code c then failwith "not a trace file")
+      "SLv6TRCE";
+    if word ic <> 1 then failwith "unsupported version of the trace format";
+    let names = Array.init (word ic) (fun _ ->
+      let b = Buffer.create 16 in
+      let rec aux () =
+        match input_byte ic with
+          | 0 -> Buffer.contents b
+          | c -> Buffer.add_char b (Char.chr c); aux () in
+      aux ()) in
+    { ic = ic; names = names; chunk = 0; regs = Array.make 15 0; cpsr = 0;
+      pc = 0; next_pc = 0; id = 0; count = 0; finished = false }
+  with End_of_file -> failwith "truncated trace file";;
+
+(* the records never cross the limit of a chunk *)
+let byte t =
+  if t.chunk = 0 then begin
+    if word t.ic <> 0 then failwith "the traces of several cores are not supported";
+    t.chunk <- word t.ic
+  end;
+  let b = input_byte t.ic in
+  t.chunk <- t.chunk - 1;
+  b;;
+
+let varint t =
+  let rec aux x shift =
+    let b = byte t in
+    let x = x lor ((b land 0x7f) lsl shift) in
+    if b land 0x80 = 0 then x else aux x (shift+7) in
+  aux 0 0;;
+
+let signed t =
+  let x = varint t in (x lsr 1) lxor (- (x land 1));;
+
+let instruction t addr =
+  t.pc <- addr;
+  t.id <- varint t;
+  if t.id >= Array.length t.names then failwith "invalid instruction id";
+  t.next_pc <- (addr + (if t.cpsr land 0x20 = 0 then 4 else 2)) land mask; (* T flag *)
+  t.count <- t.count + 1;;
+
+(* read the records until the next instruction; return false at the end
+   of the trace. The registers are then those before this instruction. *)
+let rec next_instruction t =
+  match (try Some (byte t) with End_of_file when t.chunk = 0 -> None) with
+    | None -> false
+    | Some tag ->
+      if tag = 0x01 then (instruction t t.next_pc; true)
+      else if tag = 0x02 then (instruction t ((t.pc + signed t) land mask); true)
+      else begin
+        if tag = 0x00 then begin
+          if t.count > 0 then failwith "the trace has been restarted";
+          t.pc <- varint t; t.next_pc <- t.pc;
+          t.cpsr <- varint t;
+          Array.iteri (fun n _ -> t.regs.(n) <- varint t) t.regs
+        end else if tag = 0x03 then
+          t.cpsr <- t.cpsr lxor varint t
+        else if tag >= 0x10 && tag < 0x1f then
+          t.regs.(tag-0x10) <- (t.regs.(tag-0x10) + signed t) land mask
+        else if tag = 0x21 || tag = 0x22 || tag = 0x24 then
+          (ignore (signed t); ignore (varint t))
+        else failwith "invalid record";
+        next_instruction t
+      end;;
+
+(* read the state before the next instruction; after the last
+   instruction, the address of the next one is unknown *)
+let read_state t (s : int array) =
+  if t.finished then false
+  else begin
+    if next_instruction t then (s.(0) <- t.pc; s.(17) <- t.id)
+    else (t.finished <- true; s.(0) <- -1; s.(17) <- -1);
+    s.(1) <- t.cpsr;
+    Array.blit t.regs 0 s 2 15;
+    true
+  end;;
+
+(****************************************************************************)
+(** Coq simulator *)
+
+(* number of steps of the simulator (a binary natural number) *)
+let n_of_camlint n =
+  if n = 0_l then BinNat.N0 else BinNat.Npos (Camlcoq.positive_of_camlint n);;
+let camlint_of_n = function
+  | BinNat.N0 -> 0_l
+  | BinNat.Npos p -> Camlcoq.camlint_of_positive p;;
+
+exception Coq_error of int (* number of instructions executed *) * string;;
+
+let mk_st state =
+  { Arm6_Simul.Simu.semst = { Arm6_Functions.Semantics.S.loc = [] ; bo = true ; st = state }
+  ; nb_next = BinNat.N0 };;
+
+(* execute n instructions *)
+let run lbs n =
+  let lbs = { lbs with Arm6_Simul.Simu.nb_next = n_of_camlint (Int32.of_int n) } in
+  match Arm6_Simul.S.simul lbs with
+    | Arm6_Simul.Simu.SimOk ((), lbs') -> lbs'
+    | Arm6_Simul.Simu.SimKo (lbs', m) ->
+      let left = camlint_of_n lbs'.Arm6_Simul.Simu.nb_next in
+      raise (Coq_error (n - Int32.to_int left, Messages.str_of_msg m));;
+
+let coq_state lbs =
+  let s = lbs.Arm6_Simul.Simu.semst.Arm6_Functions.Semantics.S.st in
+  let w x = Int32.to_int (Camlcoq.camlint_of_coqint x) land mask in
+  let a = Array.make state_size (-1) in
+  a.(0) <- w (Arm6_State.address_of_current_instruction s);
+  a.(1) <- w (Arm6_Proc.cpsr (Arm6_State.proc s));
+  for n = 0 to 14 do
+    a.(n+2) <- w (Arm6_State.reg_content s (Camlcoq.z_of_camlint (Int32.of_int n)))
+  done;
+  a;;
+
+(****************************************************************************)
+(** comparison *)
+
+let print_diff (sl : int array) (coq : int array) =
+  for i = 0 to compared-1 do
+    if sl.(i) <> coq.(i) && not (i = 0 && sl.(0) = -1) then
+      printf "  %-4s simlight2: 0x%08x  coq: 0x%08x\n" (field_name i) sl.(i) coq.(i)
+  done;;
+
+let instr_name t (s : int array) =
+  if s.(17) < 0 then "?" else t.names.(s.(17));;
+
+(* return true if the simulators agree on the whole trace *)
+let check test initial every filename =
+  let t = open_trace filename in
+  (* window.(i) is the state of simlight2 after base+i instructions *)
+  let window = Array.init (every+1) (fun _ -> Array.make state_size 0) in
+  let mismatch base lo sl coq =
+    printf "%s: mismatch after %d instructions" test (base+lo+1);
+    if lo >= 0 then
+      printf ", the last one at 0x%08x (%s)" window.(lo).(0) (instr_name t window.(lo));
+    printf ":\n";
+    print_diff sl coq;
+    false in
+  (* the simulators agree after base+lo instructions (Coq state lbs) and
+     differ after base+hi instructions *)
+  let rec bisect base lbs lo hi bad =
+    if hi - lo = 1 then mismatch base lo window.(hi) bad
+    else
+      let mid = (lo + hi) / 2 in
+      let lbs' = run lbs (mid - lo) in
+      let coq = coq_state lbs' in
+      if same window.(mid) coq then bisect base lbs' mid hi bad
+      else bisect base lbs lo mid coq in
+  let rec loop base lbs =
+    let rec fill i = if i <= every && read_state t window.(i) then fill (i+1) else i-1 in
+    let n = fill 1 in
+    if n = 0 then begin
+      printf "%s OK (%d instructions).\n" test base; true
+    end else
+      let lbs' =
+        try run lbs n with Coq_error (k, m) ->
+          failwith (sprintf "the Coq simulator fails after %d instructions, at 0x%08x (%s): %s"
+                      (base+k) window.(k).(0) (instr_name t window.(k)) m) in
+      let coq = coq_state lbs' in
+      if same window.(n) coq then begin
+        let w = window.(0) in
+        window.(0) <- window.(n); window.(n) <- w;
+        loop (base+n) lbs'
+      end else bisect base lbs 0 n coq in
+  let lbs = mk_st initial in
+  let result =
+    if not (read_state t window.(0)) then failwith "empty trace"
+    else
+      let coq = coq_state lbs in
+      if same window.(0) coq then loop 0 lbs
+      else mismatch 0 (-1) window.(0) coq in
+  close_in t.ic;
+  result;;
+
+let _ =
+  let every = ref 10000 and args = ref [] in
+  let usage = "Usage: lockstep [-every N] <test> <trace file>" in
+  Arg.parse
+    [ "-every", Arg.Set_int every, "N compare the states every N instructions (default 10000)" ]
+    (fun s -> args := s :: !args) usage;
+  match List.rev !args with
+    | [ test; filename ] when !every > 0 ->
+      let initial =
+        try List.assoc test tests
+        with Not_found -> eprintf "unknown test: %s\n" test; exit 2 in
+      let t0 = Unix.gettimeofday () in
+      let ok =
+        try check test initial !every filename
+        with
+          | Failure s | Sys_error s -> eprintf "Error in %s: %s.\n" test s; exit 2
+          | End_of_file -> eprintf "Error in %s: truncated trace file.\n" test; exit 2 in
+      printf "(* %.02f seconds *)\n" (Unix.gettimeofday () -. t0);
+      exit (if ok then 0 else 1)
+    | _ -> Arg.usage [] usage; exit 2;;
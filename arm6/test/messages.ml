@@ -0,0 +1,27 @@
+(*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+*)
+
+(* printing of the error messages of the Coq simulator *)
+
+let str_of_msg = 
+  let open Arm6_Message in
+  function
+  | EmptyMessage -> "EmptyMessage"
+  | ImpreciseDataAbort -> "ImpreciseDataAbort"
+  | InvalidInstructionSet -> "InvalidInstructionSet"
+  | JazelleInstructionSetNotImplemented -> "JazelleInstructionSetNotImplemented"
+  | ThumbInstructionSetNotImplemented -> "ThumbInstructionSetNotImplemented"
+  | DecodingReturnsUnpredictable -> "DecodingReturnsUnpredictable"
+  | StartOpcodeExecutionAt -> "StartOpcodeExecutionAt"
+  | While -> "While"
+  | Coproc -> "Coproc"
+  | Affect -> "Affect"
+  | Case -> "Case"
+  | ComplexSemantics -> "ComplexSemantics"
+  | NotAnAddressingMode1 -> "NotAnAddressingMode1"
+  | NotAnAddressingMode2 -> "NotAnAddressingMode2"
+  | NotAnAddressingMode3 -> "NotAnAddressingMode3"
+  | NotAnAddressingMode4 -> "NotAnAddressingMode4"
+  | NotAnAddressingMode5 -> "NotAnAddressingMode5";;
@@ -0,0 +1,18 @@
+/*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+ */
+
+/* test of the simlight2 server mode (option -server, see check-sl2):
+ * each request writes two words x and y at 0x80000; r0 should contain
+ * x+y at the end, and the word at 0x80008 should contain x*y. Without
+ * request, the words are 0. */
+
+#include "common.h"
+
+#define INPUT ((volatile uint32_t*) 0x80000)
+
+int main() {
+  INPUT[2] = INPUT[0]*INPUT[1];
+  return INPUT[0]+INPUT[1];
+}
@@ -0,0 +1,82 @@
+/*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+ */
+
+/* test LDREX and STREX with 4 cores sharing the memory (simlight2 option
+ * -smp=4). r0 should contain 0xf at the end, on each core */
+
+/* common.h is not included, because each core needs its own stack */
+typedef unsigned int uint32_t;
+
+#define CORES 4
+#define N 1000
+
+volatile uint32_t counter = 0;
+volatile uint32_t cores_mask = 0;
+volatile uint32_t arrived = 0;
+
+#define CHECK(OP, TEST) \
+  if ((TEST)) count+=(OP);
+
+/* CPU ID register of the ARM11 MPCore */
+uint32_t core_id() {
+  uint32_t id;
+  asm volatile ("mrc p15, 0, %0, c0, c0, 5" : "=r" (id));
+  return id&0xf;
+}
+
+uint32_t ldrex(volatile uint32_t *p) {
+  uint32_t x;
+  asm volatile ("ldrex %0, [%1]" : "=&r" (x) : "r" (p) : "memory");
+  return x;
+}
+
+/* return 0 if the store succeeds */
+uint32_t strex(volatile uint32_t *p, uint32_t x) {
+  uint32_t failed;
+  asm volatile ("strex %0, %2, [%1]" : "=&r" (failed) : "r" (p), "r" (x) : "memory");
+  return failed;
+}
+
+void atomic_add(volatile uint32_t *p, uint32_t n) {
+  while (strex(p,ldrex(p)+n));
+}
+
+void atomic_or(volatile uint32_t *p, uint32_t n) {
+  while (strex(p,ldrex(p)|n));
+}
+
+int main() {
+  int count = 0;
+  int i;
+  volatile uint32_t x = 0;
+  /* the cores are numbered from 0 */
+  atomic_or(&cores_mask,1<<core_id());
+  for (i = 0; i<N; ++i)
+    atomic_add(&counter,1);
+  /* wait for the other cores */
+  atomic_add(&arrived,1);
+  while (arrived!=CORES);
+  CHECK(1,cores_mask==(1<<CORES)-1);
+  /* no increment is lost */
+  CHECK(2,counter==CORES*N);
+  /* STREX fails without LDREX */
+  CHECK(4,strex(&x,1)==1 && x==0);
+  /* STREX succeeds after LDREX */
+  ldrex(&x);
+  CHECK(8,strex(&x,2)==0 && x==2);
+  return count;
+}
+
+void _start() __attribute__ ((naked));
+void _start() {
+  /* the stack of core n starts at 0xff004-n*0x1000 */
+  asm volatile ("mrc p15, 0, r0, c0, c0, 5\n\t"
+                "and r0, r0, #0xf\n\t"
+                "mov sp, #0xff000\n\t"
+                "add sp, sp, #4\n\t"
+                "sub sp, sp, r0, lsl #12");
+  main();
+  while(1);
+}
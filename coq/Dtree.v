@@ -0,0 +1,256 @@
+(**
+SimSoC-Cert, a toolkit for generating certified processor simulators.
+
+See the COPYRIGHTS and LICENSE files.
+
+Decision trees for instruction decoders.
+
+A decoder is given by an ordered list of cases: a case is the list of
+the bits having a fixed value in an encoding, and the result for a word
+having these bits. The semantics of the decoder is the result of the
+first case matching the word (first_match), like a Coq pattern matching.
+
+A decision tree tests one bit at each node, and only tries the cases
+compatible with the bits tested on the path from the root, without
+these bits. Its shape (the bits tested) is computed by simgen (see
+gencoqdec.ml), and the tree is built from the shape by dtree_build.
+Whatever the shape, the tree computes the same result as first_match
+(dtree_build_ok).
+
+The bits are read in the tuple of booleans matched by the decoders
+using a pattern matching (w28 or w16, see Bitvec.v), so that the two
+decoders can be compared (see the lemmas generated by gencoqdec.ml).
+The tests done by the tree are functions built with the tree: a node
+or a case of a leaf does not look for its bits in a list.
+*)
+
+Set Implicit Arguments.
+
+Require Import Bitvec Coqlib List Bool Arith.
+
+(* bits tested by the nodes *)
+Inductive shape : Type :=
+| SLeaf : shape
+| SNode : nat -> shape -> shape -> shape.
+
+Section dtree.
+
+  Variables W A : Type.
+
+  (* bit n of a word; test n is computed once, when the tree is built *)
+  Variable test : nat -> W -> bool.
+
+  Record dcase : Type := mk_dcase {
+    dcase_bits : list (nat * bool);
+    dcase_result : W -> word -> A
+  }.
+
+  Definition bit_ok (x : W) (nb : nat * bool) : bool :=
+    let (n, b) := nb in if test n x then b else negb b.
+
+  Definition dcase_matches (x : W) (c : dcase) : bool :=
+    forallb (bit_ok x) (dcase_bits c).
+
+  Fixpoint first_match (l : list dcase) (x : W) (w : word) (default : A) : A :=
+    match l with
+      | nil => default
+      | c :: l' =>
+        if dcase_matches x c then dcase_result c x w
+        else first_match l' x w default
+    end.
+
+  (* a case of a leaf: the test of the bits not tested by the nodes *)
+  Record ccase : Type := mk_ccase {
+    ccase_test : W -> bool;
+    ccase_result : W -> word -> A
+  }.
+
+  Fixpoint leaf_eval (l : list ccase) (x : W) (w : word) (default : A) : A :=
+    match l with
+      | nil => default
+      | c :: l' =>
+        if ccase_test c x then ccase_result c x w
+        else leaf_eval l' x w default
+    end.
+
+  Inductive dtree : Type :=
+  | TLeaf : list ccase -> dtree
+  | TNode : (W -> bool) -> dtree -> dtree -> dtree.
+
+  Fixpoint dtree_eval (t : dtree) (x : W) (w : word) (default : A) : A :=
+    match t with
+      | TLeaf l => leaf_eval l x w default
+      | TNode p t0 t1 =>
+        if p x then dtree_eval t1 x w default else dtree_eval t0 x w default
+    end.
+
+End dtree.
+
+Section build.
+
+  Variables W A : Type.
+
+  Variable test : nat -> W -> bool.
+
+  (* tell if a case may match a word whose bit n is b *)
+  Definition bit_compat (n : nat) (b : bool) (mb : nat * bool) : bool :=
+    let (m, b') := mb in if eq_nat_dec m n then eqb b b' else true.
+
+  Definition dcase_compat (n : nat) (b : bool) (c : dcase W A) : bool :=
+    forallb (bit_compat n b) (dcase_bits c).
+
+  (* remove bit n from a case *)
+  Definition other_bit (n : nat) (mb : nat * bool) : bool :=
+    let (m, _) := mb in if eq_nat_dec m n then false else true.
+
+  Definition dcase_strip (n : nat) (c : dcase W A) : dcase W A :=
+    mk_dcase (filter (other_bit n) (dcase_bits c)) (dcase_result c).
+
+  (* the cases which remain when bit n is b, without bit n *)
+  Fixpoint dcase_restrict (n : nat) (b : bool) (l : list (dcase W A))
+    : list (dcase W A) :=
+    match l with
+      | nil => nil
+      | c :: l' =>
+        if dcase_compat n b c then dcase_strip n c :: dcase_restrict n b l'
+        else dcase_restrict n b l'
+    end.
+
+  Definition bit_test (nb : nat * bool) : W -> bool :=
+    let (n, b) := nb in
+    let p := test n in if b then p else fun x => negb (p x).
+
+  Fixpoint bits_test (l : list (nat * bool)) : W -> bool :=
+    match l with
+      | nil => fun _ => true
+      | nb :: l' =>
+        let p := bit_test nb in let q := bits_test l' in fun x => p x && q x
+    end.
+
+  Definition dcase_compile (c : dcase W A) : ccase W A :=
+    mk_ccase (bits_test (dcase_bits c)) (dcase_result c).
+
+  Fixpoint dtree_build (s : shape) (l : list (dcase W A)) : dtree W A :=
+    match s with
+      | SLeaf => TLeaf (map dcase_compile l)
+      | SNode n s0 s1 =>
+        TNode (test n) (dtree_build s0 (dcase_restrict n false l))
+        (dtree_build s1 (dcase_restrict n true l))
+    end.
+
+  Lemma bit_ok_compat : forall x n mb,
+    bit_ok test x mb = true -> bit_compat n (test n x) mb = true.
+
+  Proof.
+    intros x n [m b]. unfold bit_ok, bit_compat. cbv beta iota.
+    destruct (eq_nat_dec m n) as [e|e].
+    subst m. destruct (test n x); destruct b; simpl; intro h;
+      (reflexivity || discriminate h).
+    intros _. reflexivity.
+  Qed.
+
+  Lemma forallb_compat : forall x n bits,
+    forallb (bit_compat n (test n x)) bits = false ->
+    forallb (bit_ok test x) bits = false.
+
+  Proof.
+    intros x n. induction bits as [|mb bits IH]; simpl; intro h. discriminate h.
+    case_eq (bit_ok test x mb); intro e; simpl.
+    rewrite (bit_ok_compat x n mb e) in h. simpl in h. apply IH. exact h.
+    reflexivity.
+  Qed.
+
+  Lemma forallb_strip : forall x n bits,
+    forallb (bit_compat n (test n x)) bits = true ->
+    forallb (bit_ok test x) (filter (other_bit n) bits)
+    = forallb (bit_ok test x) bits.
+
+  Proof.
+    intros x n. induction bits as [|[m b] bits IH]; simpl. auto.
+    destruct (eq_nat_dec m n) as [e|e]; simpl; intro h.
+    subst m. destruct (andb_prop _ _ h) as [h1 h2]. rewrite (IH h2).
+    apply eqb_prop in h1. rewrite <- h1. destruct (test n x); reflexivity.
+    rewrite (IH h). reflexivity.
+  Qed.
+
+  Lemma dcase_matches_false : forall x n c,
+    dcase_compat n (test n x) c = false -> dcase_matches test x c = false.
+
+  Proof.
+    intros x n c. exact (forallb_compat x n (dcase_bits c)).
+  Qed.
+
+  Lemma dcase_matches_strip : forall x n c,
+    dcase_compat n (test n x) c = true ->
+    dcase_matches test x (dcase_strip n c) = dcase_matches test x c.
+
+  Proof.
+    intros x n c. exact (forallb_strip x n (dcase_bits c)).
+  Qed.
+
+  Lemma first_match_restrict : forall x n w default l,
+    first_match test (dcase_restrict n (test n x) l) x w default
+    = first_match test l x w default.
+
+  Proof.
+    intros x n w default. induction l as [|c l IH]. reflexivity.
+    change (first_match test (if dcase_compat n (test n x) c
+      then dcase_strip n c :: dcase_restrict n (test n x) l
+      else dcase_restrict n (test n x) l) x w default
+      = first_match test (c :: l) x w default).
+    case_eq (dcase_compat n (test n x) c); intro e.
+    change ((if dcase_matches test x (dcase_strip n c) then dcase_result c x w
+      else first_match test (dcase_restrict n (test n x) l) x w default)
+      = first_match test (c :: l) x w default).
+    rewrite (dcase_matches_strip x n c e), IH. reflexivity.
+    change (first_match test (dcase_restrict n (test n x) l) x w default
+      = if dcase_matches test x c then dcase_result c x w
+        else first_match test l x w default).
+    rewrite IH, (dcase_matches_false x n c e). reflexivity.
+  Qed.
+
+  Lemma bit_test_ok : forall x nb, bit_test nb x = bit_ok test x nb.
+
+  Proof.
+    intros x [n b]. unfold bit_test, bit_ok.
+    destruct b; simpl; destruct (test n x); reflexivity.
+  Qed.
+
+  Lemma bits_test_ok : forall x l,
+    bits_test l x = forallb (bit_ok test x) l.
+
+  Proof.
+    intro x. induction l as [|nb l IH]. reflexivity.
+    change (bit_test nb x && bits_test l x
+      = bit_ok test x nb && forallb (bit_ok test x) l).
+    rewrite bit_test_ok, IH. reflexivity.
+  Qed.
+
+  Lemma leaf_eval_compile : forall x w default l,
+    leaf_eval (map dcase_compile l) x w default
+    = first_match test l x w default.
+
+  Proof.
+    intros x w default. induction l as [|c l IH]. reflexivity.
+    change ((if bits_test (dcase_bits c) x then dcase_result c x w
+      else leaf_eval (map dcase_compile l) x w default)
+      = (if dcase_matches test x c then dcase_result c x w
+      else first_match test l x w default)).
+    rewrite bits_test_ok, IH. reflexivity.
+  Qed.
+
+  Theorem dtree_build_ok : forall x s l w default,
+    dtree_eval (dtree_build s l) x w default = first_match test l x w default.
+
+  Proof.
+    intro x. induction s as [|n s0 IH0 s1 IH1]; intros l w default.
+    apply leaf_eval_compile.
+    change ((if test n x
+      then dtree_eval (dtree_build s1 (dcase_restrict n true l)) x w default
+      else dtree_eval (dtree_build s0 (dcase_restrict n false l)) x w default)
+      = first_match test l x w default).
+    rewrite <- (first_match_restrict x n w default l).
+    case_eq (test n x); intro e. rewrite IH1. reflexivity. rewrite IH0. reflexivity.
+  Qed.
+
+End build.
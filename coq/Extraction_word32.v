@@ -0,0 +1,90 @@
+(**
+SimSoC-Cert, a toolkit for generating certified processor simulators.
+
+See the COPYRIGHTS and LICENSE files.
+
+Extraction of the 32-bit words (Int.int of CompCert, see Bitvec.v) to
+the OCaml type int32. This file is loaded before extraction.v when
+make is called with WORD32=1 (see Makefile.common).
+
+Justification. By default, a word is extracted as its unsigned value
+(a binary integer Z, allocated in the heap), and every operation goes
+through Z. Here, a word w is represented by the int32 whose bits are
+those of (unsigned w), and the operations are realized in word32.ml:
+- the conversions (repr, intval, unsigned, signed) and the constructor
+  mkint, which is only applied to values in [0, 2^32), by repr;
+- the arithmetic and bitwise operations by the corresponding
+  operations of Int32, which compute modulo 2^32 like repr;
+- the shifts and rotations by the Int32 shifts, after checking that
+  the amount (an unsigned word) is smaller than 32, as in the Coq
+  definitions (bits out of range are 0, or the sign bit for shr);
+- the divisions by the divisions of Int32 (signed) or Int64 (unsigned)
+  and zero_ext, sign_ext by masks and shifts, the degenerate cases (a
+  zero divisor, a width out of (0, 32]) following the definitions on Z;
+- cmp and cmpu are not realized: their extraction uses eq, lt and ltu;
+- the bit operations of Bitvec (masks, bits, set_bits...) by loops on
+  the bit positions, following their definitions.
+word32.ml does not refer to Integers, which may be extracted with
+WORD32=1 too. All these realizations are compared with the extracted
+Coq functions by "make -C coq check-word32" (see word32_check.ml).
+
+The other instances of Integers.Make (byte, half, address...) are
+unchanged. An operation of Int which is used but not realized here
+makes the compilation of the extracted code fail, since it expects a
+Z instead of an int32: it cannot be silently mixed.
+
+The Clight ASTs of simlight (arm6/simlight*) contain CompCert integers
+which are printed by CompCert itself: they must not be extracted with
+WORD32=1. *)
+
+Require Import Integers Bitvec.
+
+Extract Inductive Int.int => "int32" [ "Word32.mkint" ] "Word32.match_int".
+
+(* conversions *)
+Extract Constant Int.intval => "Word32.intval".
+Extract Constant Int.unsigned => "Word32.unsigned".
+Extract Constant Int.signed => "Word32.signed".
+Extract Constant Int.repr => "Word32.repr".
+Extract Constant Int.zero => "0l".
+Extract Constant Int.one => "1l".
+Extract Constant Int.mone => "(-1l)".
+
+(* comparisons *)
+Extract Constant Int.eq_dec => "Word32.eq".
+Extract Constant Int.eq => "Word32.eq".
+Extract Constant Int.lt => "Word32.lt".
+Extract Constant Int.ltu => "Word32.ltu".
+
+(* arithmetic *)
+Extract Constant Int.neg => "Int32.neg".
+Extract Constant Int.add => "Int32.add".
+Extract Constant Int.sub => "Int32.sub".
+Extract Constant Int.mul => "Int32.mul".
+Extract Constant Int.divs => "Word32.divs".
+Extract Constant Int.mods => "Word32.mods".
+Extract Constant Int.divu => "Word32.divu".
+Extract Constant Int.modu => "Word32.modu".
+
+(* bitwise operations *)
+Extract Constant Int.and => "Int32.logand".
+Extract Constant Int.or => "Int32.logor".
+Extract Constant Int.xor => "Int32.logxor".
+Extract Constant Int.not => "Int32.lognot".
+Extract Constant Int.shl => "Word32.shl".
+Extract Constant Int.shru => "Word32.shru".
+Extract Constant Int.shr => "Word32.shr".
+Extract Constant Int.rol => "Word32.rol".
+Extract Constant Int.ror => "Word32.ror".
+Extract Constant Int.zero_ext => "Word32.zero_ext".
+Extract Constant Int.sign_ext => "Word32.sign_ext".
+
+(* bit operations of Bitvec *)
+Extract Constant Bitvec.masks => "Word32.masks".
+Extract Constant Bitvec.bits => "Word32.bits".
+Extract Constant Bitvec.bit => "Word32.bit".
+Extract Constant Bitvec.is_set => "Word32.is_set".
+Extract Constant Bitvec.set => "Word32.set".
+Extract Constant Bitvec.clear => "Word32.clear".
+Extract Constant Bitvec.set_bit => "Word32.set_bit".
+Extract Constant Bitvec.set_bits => "Word32.set_bits".
@@ -8,9 +8,25 @@ Coq functor building a simulator given the semantics of instructions
 
 Set Implicit Arguments.
 
-Require Import Bitvec Semantics.
+Require Import Bitvec Semantics NArith Pnat.
 Require Recdef.
 
+(* The number of remaining steps is a binary natural number, so that
+running n steps of the extracted simulator does not allocate a unary
+number of size n. The termination is still proved on nat_of_N. *)
+
+Lemma nat_of_Npred_lt : forall p, (nat_of_N (Npred (Npos p)) < nat_of_P p)%nat.
+
+Proof.
+  intro p. destruct (Psucc_pred p) as [e|e].
+  subst p. simpl. auto with arith.
+  replace (Npred (Npos p)) with (Npos (Ppred p)).
+  change (nat_of_P (Ppred p) < nat_of_P p)%nat.
+  set (q := Ppred p) in *. rewrite <- e.
+  rewrite nat_of_P_succ_morphism. auto with arith.
+  destruct p; try reflexivity. simpl in e. discriminate e.
+Qed.
+
 Module Type SEMANTICS (Import P : PROC) (Import S : STATE P) (Import M : MESSAGE).
   Parameter semstate : Set.
   Parameter result : Type -> Type.
@@ -53,7 +69,7 @@ Module Make (Import P : PROC) (Import S : STATE P) (Import M : MESSAGE) (Import
 
   Record simul_state := mk_simul_state
     { semst : semstate
-    ; nb_next : nat }.
+    ; nb_next : N }.
 
   Inductive simul_result {A} : Type :=
   | SimOk : A -> simul_state -> simul_result
@@ -122,17 +138,20 @@ Module Make (Import P : PROC) (Import S : STATE P) (Import M : MESSAGE) (Import
             end) x
       end.
 
-    Function simul (lbs : simul_state) {measure nb_next lbs} : @simul_result unit :=
+    Definition steps lbs := nat_of_N (nb_next lbs).
+
+    Function simul (lbs : simul_state) {measure steps lbs} : @simul_result unit :=
       match nb_next lbs with
-        | 0%nat => SimOk tt lbs
-        | S n' =>
+        | N0 => SimOk tt lbs
+        | Npos p =>
           match inM next lbs with
-            | SimOk _ s' => simul (mk_simul_state (semst s') n')
+            | SimOk _ s' => simul (mk_simul_state (semst s') (Npred (Npos p)))
             | SimKo s m => SimKo s m
           end
       end.
-      unfold nb_next.
-      auto with *.
+      intros. unfold steps. simpl nb_next.
+      match goal with H : nb_next _ = Npos _ |- _ => rewrite H end.
+      apply nat_of_Npred_lt.
     Defined.
 
   End Make.
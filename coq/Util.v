@@ -262,6 +262,74 @@ Section update_map.
 
 End update_map.
 
+(****************************************************************************)
+(** functions with efficient updates: an initial function, plus the
+updated values stored in a binary trie (ZMap of CompCert), indexed by
+an injective function to Z. Reading or updating costs O(log n) in the
+extracted code, instead of O(number of updates) with update_map. *)
+(****************************************************************************)
+
+Require Import Maps.
+
+Record tmap (A B : Type) : Type := mk_tmap {
+  tmap_init : A -> B;
+  tmap_updates : ZMap.t (option B)
+}.
+
+Section tmap.
+
+  Variables (A B : Type) (index : A -> Z).
+
+  Definition tmap_of_fun (f : A -> B) : tmap A B := mk_tmap f (ZMap.init None).
+
+  Definition tmap_get (m : tmap A B) (a : A) : B :=
+    match ZMap.get (index a) (tmap_updates m) with
+      | Some b => b
+      | None => tmap_init m a
+    end.
+
+  Definition tmap_set (m : tmap A B) (a : A) (b : B) : tmap A B :=
+    mk_tmap (tmap_init m) (ZMap.set (index a) (Some b) (tmap_updates m)).
+
+  Lemma tmap_get_init : forall f a, tmap_get (tmap_of_fun f) a = f a.
+
+  Proof.
+    intros. unfold tmap_get, tmap_of_fun.
+    cbv beta iota delta [tmap_updates tmap_init]. rewrite ZMap.gi. refl.
+  Qed.
+
+  Lemma tmap_get_set_same : forall m a b, tmap_get (tmap_set m a b) a = b.
+
+  Proof.
+    intros [f t] a b. unfold tmap_get, tmap_set.
+    cbv beta iota delta [tmap_updates tmap_init]. rewrite ZMap.gss. refl.
+  Qed.
+
+  Variable index_inj : forall x y, index x = index y -> x = y.
+
+  Lemma tmap_get_set_other : forall m a b x,
+    a <> x -> tmap_get (tmap_set m a b) x = tmap_get m x.
+
+  Proof.
+    intros [f t] a b x H. unfold tmap_get, tmap_set.
+    cbv beta iota delta [tmap_updates tmap_init]. rewrite ZMap.gso. refl.
+    intro E. apply H. apply index_inj. symmetry. hyp.
+  Qed.
+
+  Variable eqdec : forall x y : A, {x=y}+{~x=y}.
+
+  (* tmap_set behaves as update_map on the function tmap_get *)
+  Lemma tmap_get_set : forall m a b x,
+    tmap_get (tmap_set m a b) x = update_map eqdec (tmap_get m) a b x.
+
+  Proof.
+    intros. unfold update_map. destruct (eqdec x a) as [E|E].
+    subst. apply tmap_get_set_same.
+    apply tmap_get_set_other. intro E'. apply E. symmetry. hyp.
+  Qed.
+
+End tmap.
+
 (****************************************************************************)
 (** [clist a k] builds a list of [a]'s of length [k] *)
 (****************************************************************************)
@@ -6,7 +6,7 @@ See the COPYRIGHTS and LICENSE files.
 Extraction of the Arm6 simulator.
 *)
 
-Require Extraction Simul Cnotations.
+Require Extraction Simul Cnotations Dtree.
 
 Cd "extraction".
 
@@ -17,3 +17,4 @@ Extraction Library Simul.
 Extraction Library NaryFunctions.
 Extraction Library Bvector.
 Extraction Library Cnotations.
+Extraction Library Dtree.
@@ -0,0 +1,181 @@
+(*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+
+Realization of the 32-bit words of Bitvec (Int.int of CompCert) by
+int32, used by the extraction with WORD32=1 (see Extraction_word32.v).
+A word is represented by the int32 having the same bits as its
+unsigned value; the functions below follow the Coq definitions, and
+are tested against them by word32_check.ml.
+*)
+
+open Datatypes
+open BinPos
+open BinInt
+
+(****************************************************************************)
+(** conversions *)
+
+(* value modulo 2^32 of a positive *)
+let rec low32 = function
+  | Coq_xH -> 1l
+  | Coq_xO p -> Int32.shift_left (low32 p) 1
+  | Coq_xI p -> Int32.logor (Int32.shift_left (low32 p) 1) 1l;;
+
+(* positive of a non-zero int32, read as unsigned *)
+let rec positive x =
+  if x = 1l then Coq_xH
+  else
+    let p = positive (Int32.shift_right_logical x 1) in
+    if Int32.logand x 1l = 0l then Coq_xO p else Coq_xI p;;
+
+let repr = function
+  | Z0 -> 0l
+  | Zpos p -> low32 p
+  | Zneg p -> Int32.neg (low32 p);;
+
+let intval x = if x = 0l then Z0 else Zpos (positive x);;
+
+let unsigned = intval;;
+
+let signed x =
+  if Int32.compare x 0l >= 0 then intval x else Zneg (positive (Int32.neg x));;
+
+(* mkint is only applied to a value in [0, 2^32) *)
+let mkint = repr;;
+
+let match_int f x = f (intval x);;
+
+(****************************************************************************)
+(** comparisons *)
+
+let eq x y = Int32.compare x y = 0;;
+
+let lt x y = Int32.compare x y < 0;;
+
+let ltu x y =
+  Int32.compare (Int32.add x Int32.min_int) (Int32.add y Int32.min_int) < 0;;
+
+(****************************************************************************)
+(** divisions and extensions *)
+
+(* Integers is not used here, since it may itself be extracted with
+   WORD32=1: only the Coq libraries on Z (Zdiv, Zpower) are. *)
+
+(* signed division and remainder, rounded towards zero like Int32.div
+   and Int32.rem (which give min_int and 0 for min_int and -1, as
+   repr does); a division by zero gives 0, and its remainder x *)
+let divs x y = if y = 0l then 0l else Int32.div x y;;
+let mods x y = if y = 0l then x else Int32.rem x y;;
+
+(* unsigned division and remainder, on 64 bits; the case y = 0 follows
+   the convention of Zdiv *)
+let unsigned64 x = Int64.logand (Int64.of_int32 x) 0xffffffffL;;
+
+let divu x y =
+  if y = 0l then repr (Zdiv.coq_Zdiv (intval x) Z0)
+  else Int64.to_int32 (Int64.div (unsigned64 x) (unsigned64 y));;
+
+let modu x y =
+  if y = 0l then repr (Zdiv.coq_Zmod (intval x) Z0)
+  else Int64.to_int32 (Int64.rem (unsigned64 x) (unsigned64 y));;
+
+(* the value of n if 0 < n <= 32 *)
+let width = function
+  | Zpos p ->
+      let rec aux = function
+        | Coq_xH -> 1
+        | Coq_xO p -> min 33 (2 * aux p)
+        | Coq_xI p -> min 33 (2 * aux p + 1) in
+      let k = aux p in if k <= 32 then Some k else None
+  | Z0 | Zneg _ -> None;;
+
+(* the other widths follow the Coq definitions on Z *)
+let zero_ext n x =
+  match width n with
+    | Some 32 -> x
+    | Some k -> Int32.logand x (Int32.pred (Int32.shift_left 1l k))
+    | None -> repr (Zdiv.coq_Zmod (intval x) (Zpower.two_p n));;
+
+let sign_ext n x =
+  match width n with
+    | Some k -> Int32.shift_right (Int32.shift_left x (32-k)) (32-k)
+    | None ->
+        let p = Zpower.two_p n in
+        let y = Zdiv.coq_Zmod (intval x) p in
+        match coq_Zcompare y (Zpower.two_p (coq_Zminus n (Zpos Coq_xH))) with
+          | Lt -> repr y
+          | Eq | Gt -> repr (coq_Zminus y p);;
+
+(****************************************************************************)
+(** shifts and rotations *)
+
+(* tell if the unsigned value of y is smaller than 32 *)
+let small y = Int32.compare y 0l >= 0 && Int32.compare y 32l < 0;;
+
+let shl x y = if small y then Int32.shift_left x (Int32.to_int y) else 0l;;
+
+let shru x y =
+  if small y then Int32.shift_right_logical x (Int32.to_int y) else 0l;;
+
+let shr x y =
+  Int32.shift_right x (if small y then Int32.to_int y else 31);;
+
+let ror x y =
+  let n = Int32.to_int (Int32.logand y 31l) in
+  if n = 0 then x
+  else Int32.logor (Int32.shift_right_logical x n) (Int32.shift_left x (32-n));;
+
+let rol x y =
+  let n = Int32.to_int (Int32.logand y 31l) in
+  if n = 0 then x
+  else Int32.logor (Int32.shift_left x n) (Int32.shift_right_logical x (32-n));;
+
+(****************************************************************************)
+(** bit operations of Bitvec *)
+
+let rec int_of_nat = function
+  | O -> 0
+  | S n -> succ (int_of_nat n);;
+
+(* bit i of x, false if i >= 32 *)
+let get_bit i x =
+  i < 32 && Int32.logand (Int32.shift_right_logical x i) 1l <> 0l;;
+
+(* set bit i of x to b, if i < 32 *)
+let put_bit i b x =
+  if i >= 32 then x
+  else if b then Int32.logor x (Int32.shift_left 1l i)
+  else Int32.logand x (Int32.lognot (Int32.shift_left 1l i));;
+
+(* bits n to n+k *)
+let masks_int n k =
+  let rec aux i m =
+    if i > n+k || i >= 32 then m
+    else aux (succ i) (Int32.logor m (Int32.shift_left 1l i)) in
+  aux n 0l;;
+
+let masks p n =
+  let p = int_of_nat p and n = int_of_nat n in masks_int n (max 0 (p-n));;
+
+let bits p n w =
+  let m = Int32.logand (masks p n) w and n = int_of_nat n in
+  if n >= 32 then 0l else Int32.shift_right_logical m n;;
+
+let bit n w = bits n n w;;
+
+let is_set n w = get_bit (int_of_nat n) w;;
+
+let set n w = put_bit (int_of_nat n) true w;;
+
+let clear n w = put_bit (int_of_nat n) false w;;
+
+let set_bit n v w = put_bit (int_of_nat n) (v <> 0l) w;;
+
+(* w[p:p-k] := v[k:0], as set_bits_aux *)
+let set_bits p n v w =
+  let p = int_of_nat p and n = int_of_nat n in
+  let rec aux p k w =
+    let w = put_bit p (get_bit k v) w in
+    if k = 0 then w else aux (p-1) (k-1) w in
+  aux p (max 0 (p-n)) w;;
@@ -0,0 +1,122 @@
+(*
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files
+
+Comparison of the realization of the words by int32 (word32.ml) with
+the functions extracted from Coq (Integers of CompCert, and Bitvec
+extracted without WORD32=1), on limit values and random values.
+*)
+
+open Printf
+
+let errors = ref 0;;
+
+let check name ok args =
+  if not ok then begin
+    incr errors;
+    if !errors <= 20 then printf "Error: %s %s.\n" name (String.concat " " args)
+  end;;
+
+let hex = sprintf "0x%lx";;
+
+(* the Coq word of an int32 *)
+let z = Word32.intval;;
+
+let same_word name x y args = check name (Word32.intval x = y) args;;
+
+(****************************************************************************)
+(** values *)
+
+let limits =
+  [ 0l; 1l; 2l; 3l; 7l; 8l; 15l; 16l; 31l; 32l; 33l; 63l; 64l; 255l;
+    0x7fffl; 0x8000l; 0xffffl; 0x7fffffffl; Int32.min_int; 0x80000001l;
+    0xfffffffel; -1l; -31l; -32l; -33l ];;
+
+let random () =
+  Int32.logxor (Int32.of_int (Random.bits ()))
+    (Int32.shift_left (Int32.of_int (Random.bits ())) 16);;
+
+let values = limits @ Array.to_list (Array.init 200 (fun _ -> random ()));;
+
+let rec nat_of_int n = if n = 0 then Datatypes.O else Datatypes.S (nat_of_int (n-1));;
+
+let positions = Array.to_list (Array.init 36 (fun i -> i));;
+
+(****************************************************************************)
+(** Int *)
+
+let unary name f g =
+  List.iter (fun x -> same_word name (f x) (g (z x)) [hex x]) values;;
+
+let binary name f g =
+  List.iter (fun x -> List.iter (fun y ->
+    same_word name (f x y) (g (z x) (z y)) [hex x; hex y]) values) values;;
+
+let predicate name f g =
+  List.iter (fun x -> List.iter (fun y ->
+    check name (f x y = g (z x) (z y)) [hex x; hex y]) values) values;;
+
+let check_int () =
+  let module I = Integers.Int in
+  List.iter (fun x ->
+    check "repr" (Word32.repr (z x) = x) [hex x];
+    check "signed" (Word32.signed x = I.signed (z x)) [hex x];
+    check "repr" (Word32.repr (I.signed (z x)) = x) [hex x]) values;
+  unary "neg" Int32.neg I.neg;
+  unary "not" Int32.lognot I.not;
+  binary "add" Int32.add I.add;
+  binary "sub" Int32.sub I.sub;
+  binary "mul" Int32.mul I.mul;
+  binary "and" Int32.logand I.coq_and;
+  binary "or" Int32.logor I.coq_or;
+  binary "xor" Int32.logxor I.xor;
+  binary "shl" Word32.shl I.shl;
+  binary "shru" Word32.shru I.shru;
+  binary "shr" Word32.shr I.shr;
+  binary "rol" Word32.rol I.rol;
+  binary "ror" Word32.ror I.ror;
+  binary "divs" Word32.divs I.divs;
+  binary "mods" Word32.mods I.mods;
+  binary "divu" Word32.divu I.divu;
+  binary "modu" Word32.modu I.modu;
+  List.iter (fun n ->
+    let n' = Word32.signed (Int32.of_int n) in
+    unary ("zero_ext " ^ string_of_int n) (Word32.zero_ext n') (I.zero_ext n');
+    unary ("sign_ext " ^ string_of_int n) (Word32.sign_ext n') (I.sign_ext n'))
+    (-2 :: -1 :: positions);
+  predicate "eq" Word32.eq I.eq;
+  predicate "lt" Word32.lt I.lt;
+  predicate "ltu" Word32.ltu I.ltu;;
+
+(****************************************************************************)
+(** Bitvec *)
+
+let check_bitvec () =
+  List.iter (fun p -> List.iter (fun n ->
+    let p' = nat_of_int p and n' = nat_of_int n in
+    let args x = [string_of_int p; string_of_int n; hex x] in
+    same_word "masks" (Word32.masks p' n') (Bitvec.masks p' n') (args 0l);
+    List.iter (fun x ->
+      same_word "bits" (Word32.bits p' n' x) (Bitvec.bits p' n' (z x)) (args x);
+      List.iter (fun w ->
+        same_word "set_bits" (Word32.set_bits p' n' x w)
+          (Bitvec.set_bits p' n' (z x) (z w)) (args x @ [hex w]))
+        limits) limits) positions) positions;
+  List.iter (fun n ->
+    let n' = nat_of_int n in
+    let args x = [string_of_int n; hex x] in
+    List.iter (fun x ->
+      same_word "bit" (Word32.bit n' x) (Bitvec.bit n' (z x)) (args x);
+      check "is_set" (Word32.is_set n' x = Bitvec.is_set n' (z x)) (args x);
+      same_word "set" (Word32.set n' x) (Bitvec.set n' (z x)) (args x);
+      same_word "clear" (Word32.clear n' x) (Bitvec.clear n' (z x)) (args x);
+      List.iter (fun v ->
+        same_word "set_bit" (Word32.set_bit n' v x)
+          (Bitvec.set_bit n' (z v) (z x)) (args x @ [hex v]))
+        limits) values) positions;;
+
+let _ =
+  check_int ();
+  check_bitvec ();
+  if !errors = 0 then print_endline "Word32 OK."
+  else (printf "%d errors.\n" !errors; exit 1);;
@@ -142,22 +142,23 @@ let _ = dispatch & function
       
       (**   - the SimSoC-Cert project : *)
       List.iter (fun (n, l) -> define_context n l)
-        [ "coq/extraction", l_compcert
+        [ "coq", l_compcert @ [ "coq/extraction" ]
+        ; "coq/extraction", l_compcert @ [ "coq" ]
         ; "simgen", l_compcert @ [ "simgen/extraction" ]
-        ; "simgen/extraction", [ "compcert/extraction" ; "coq/extraction" ]
+        ; "simgen/extraction", [ "compcert/extraction" ; "coq" ; "coq/extraction" ]
 
         ; "arm6/parsing", [ "simgen" ]
-        ; "arm6/coq/extraction", [ "compcert/extraction" ; "coq/extraction" ; "simgen/extraction" ] 
+        ; "arm6/coq/extraction", [ "compcert/extraction" ; "coq" ; "coq/extraction" ; "simgen/extraction" ] 
         ; "arm6/simlight/extraction", l_compcert @ [ "coq/extraction" ]
         ; "arm6/simlight2/extraction", l_compcert @ [ "coq/extraction" ]
-        ; "arm6/test", l_compcert @ [ "arm6/coq" ; "compcert/extraction" ; "coq/extraction" ; "simgen/extraction" ; "arm6/coq/extraction" ; "arm6/test/extraction" ]
-        ; "arm6/test/extraction", l_compcert @ [ "coq/extraction" ; "arm6/coq/extraction" ]
+        ; "arm6/test", l_compcert @ [ "arm6/coq" ; "compcert/extraction" ; "coq" ; "coq/extraction" ; "simgen/extraction" ; "arm6/coq/extraction" ; "arm6/test/extraction" ]
+        ; "arm6/test/extraction", l_compcert @ [ "coq" ; "coq/extraction" ; "arm6/coq/extraction" ]
 
         ; "sh4/parsing", [ "compcert/cfrontend" (* we just use the library [Cparser] which is virtually inside [cfrontend] *) ]
-        ; "sh4/coq/extraction", [ "compcert/extraction" ; "coq/extraction" ; "simgen/extraction" ] 
+        ; "sh4/coq/extraction", [ "compcert/extraction" ; "coq" ; "coq/extraction" ; "simgen/extraction" ] 
         ; "sh4/simlight/extraction", l_compcert @ [ "coq/extraction" ]
-        ; "sh4/test", l_compcert @ [ "sh4/coq" ; "compcert/extraction" ; "coq/extraction" ; "simgen/extraction" ; "sh4/coq/extraction" ; "sh4/test/extraction" ]
-        ; "sh4/test/extraction", l_compcert @ [ "coq/extraction" ; "sh4/coq/extraction" ]
+        ; "sh4/test", l_compcert @ [ "sh4/coq" ; "compcert/extraction" ; "coq" ; "coq/extraction" ; "simgen/extraction" ; "sh4/coq/extraction" ; "sh4/test/extraction" ]
+        ; "sh4/test/extraction", l_compcert @ [ "coq" ; "coq/extraction" ; "sh4/coq/extraction" ]
 
         ; "devel/tuong/sh4/parsing_frontc", [ "devel/tuong/sh4/patching" ] ];
 
@@ -27,15 +27,22 @@ module Sh_Test (Sh4_Dec : SH4DEC) : TEST =
 struct
   type state = Sh4_State.state
 
+(* number of steps of the simulator (a binary natural number) *)
+let n_of_camlint n =
+  if n = 0_l then BinNat.N0 else BinNat.Npos (Camlcoq.positive_of_camlint n);;
+let camlint_of_n = function
+  | BinNat.N0 -> 0_l
+  | BinNat.Npos p -> Camlcoq.camlint_of_positive p;;
+
 let simul lbs = 
-  let n = Camlcoq.camlint_of_nat (Sh4_Simul.Simu.nb_next lbs) in
+  let n = camlint_of_n (Sh4_Simul.Simu.nb_next lbs) in
   Sh4_Simul.Simu.catch Sh4_Simul.S.simul (fun m lbs ->
     let num = Sh4_Simul.Simu.nb_next lbs in
-    let step = string_of_int (n - Camlcoq.camlint_of_nat num) in
+    let step = Int32.to_string (Int32.sub n (camlint_of_n num)) in
     failwith ("SimKo: " ^ str_of_msg m ^ " at step " ^ step)) lbs;;
 
 let next = 
-  Sh4_Simul.Simu.bind (fun lbs -> Sh4_Simul.Simu.SimOk ((), { lbs with Sh4_Simul.Simu.nb_next = n1 }))
+  Sh4_Simul.Simu.bind (fun lbs -> Sh4_Simul.Simu.SimOk ((), { lbs with Sh4_Simul.Simu.nb_next = BinNat.Npos Coq_xH }))
     (fun () -> simul);;
 
 let (+) = Int32.add
@@ -66,7 +73,7 @@ let stack s =
 let return a lbs = Sh4_Simul.Simu.SimOk (a, lbs)
 
 let mk_st state steps = 
-  { Sh4_Simul.Simu.semst = { Sh4_Functions.Semantics.S.loc = [] ; bo = true ; st = state } ; nb_next = Camlcoq.nat_of_camlint steps }
+  { Sh4_Simul.Simu.semst = { Sh4_Functions.Semantics.S.loc = [] ; bo = true ; st = state } ; nb_next = n_of_camlint steps }
 
 let get_st f x = f x.Sh4_Simul.Simu.semst.Sh4_Functions.Semantics.S.st x
 
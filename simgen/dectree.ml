@@ -0,0 +1,134 @@
+(**
+SimSoC-Cert, a toolkit for generating certified processor simulators
+See the COPYRIGHTS and LICENSE files.
+
+Decision trees for instruction decoders.
+
+A decoder is given by an ordered list of cases. Each case has the list
+of the bits having a fixed value in its encoding (position, value), and
+the first case matching a word gives the result (Coq decoders), or all
+the cases matching a word are tried (C decoders). A node of a decision
+tree tests one bit, and its sons only keep the cases compatible with
+the value of this bit. The bit tested by a node is the one which
+discriminates the remaining cases the most, i.e. which minimizes the
+number of cases in the biggest son.
+
+Whatever the bits tested, the order of the cases is kept in each
+leaf, so that the cases matching a word are the same, in the same
+order, as in the list (see coq/Dtree.v for the proof on the Coq side).
+*)
+
+type 'a case = 'a * (int * bool) list;;
+
+type 'a tree =
+  | Leaf of 'a case list
+  | Node of int * 'a tree * 'a tree;; (* bit tested, sons for 0 and 1 *)
+
+(*****************************************************************************)
+(** construction *)
+(*****************************************************************************)
+
+(* tell if a case may match a word whose bit n is b *)
+let compatible n b ((_, bits) : 'a case) =
+  List.for_all (fun (m, b') -> m <> n || b' = b) bits;;
+
+(* number of cases which remain in each son if bit n is tested *)
+let split_sizes n cases =
+  List.fold_left (fun (n0, n1) c ->
+    (if compatible n false c then n0+1 else n0),
+    (if compatible n true c then n1+1 else n1)) (0, 0) cases;;
+
+(* the bit to test among the bits fixed by the cases and not yet tested:
+   None if no bit reduces the number of cases *)
+let best_bit tested cases =
+  let candidates =
+    List.fold_left (fun s (_, bits) ->
+      List.fold_left (fun s (n, _) ->
+        if List.mem n tested || List.mem n s then s else n :: s) s bits)
+      [] cases in
+  let size = List.length cases in
+  let best = List.fold_left (fun best n ->
+    let n0, n1 = split_sizes n cases in
+    let cost = (max n0 n1, n0+n1) in
+      match best with
+        | Some (_, c) when compare c cost <= 0 -> best
+        | Some _ | None -> Some (n, cost)) None (List.sort compare candidates) in
+    match best with
+      | Some (n, (m, _)) when m < size -> Some n
+      | Some _ | None -> None;;
+
+(* If first is true, only the first case matching a word is used, so
+   a leaf is not split anymore when its first case matches all its
+   words. Otherwise, all the cases matching a word are used, and the
+   leaves are split as long as a bit discriminates their cases. *)
+let rec build_tree first tested cases =
+  match cases with
+    | [] | [_] -> Leaf cases
+    | (_, bits) :: _
+        when first && List.for_all (fun (n, _) -> List.mem n tested) bits ->
+        Leaf cases
+    | _ :: _ ->
+        begin match best_bit tested cases with
+          | None -> Leaf cases
+          | Some n ->
+              let tested = n :: tested in
+                Node (n,
+                      build_tree first tested (List.filter (compatible n false) cases),
+                      build_tree first tested (List.filter (compatible n true) cases))
+        end;;
+
+let build first cases = build_tree first [] cases;;
+
+(*****************************************************************************)
+(** statistics *)
+(*****************************************************************************)
+
+let rec nb_nodes = function
+  | Leaf _ -> 0
+  | Node (_, t0, t1) -> 1 + nb_nodes t0 + nb_nodes t1;;
+
+let rec depth = function
+  | Leaf _ -> 0
+  | Node (_, t0, t1) -> 1 + max (depth t0) (depth t1);;
+
+(* number of the bits tested to recognize each case of a leaf, when only
+   the first matching case is used: the bits of the cases before it in
+   the leaf which are not yet tested, until one of them is found to be
+   different, and the remaining bits of the case itself; the worst case
+   is counted, when all the previous cases only differ on their last
+   bit *)
+let first_leaf_tests tested cases =
+  let untested (_, bits) =
+    List.length (List.filter (fun (n, _) -> not (List.mem n tested)) bits) in
+  let rec aux before = function
+    | [] -> []
+    | c :: cs -> before + untested c :: aux (before + untested c) cs in
+    aux 0 cases;;
+
+(* for each case recognized by the tree (a case may be in several
+   leaves), the maximum number of tests to recognize it: the nodes
+   from the root, and the tests done in the leaf, given by leaf_tests
+   for each case of the leaf; the cases are identified by their first
+   component *)
+let tests leaf_tests t =
+  let h = Hashtbl.create 256 in
+  let rec aux tested d = function
+    | Leaf cases ->
+        List.iter2 (fun (x, _) k ->
+          let k = d + k in
+            if k > (try Hashtbl.find h x with Not_found -> -1) then
+              Hashtbl.replace h x k)
+          cases (leaf_tests tested cases)
+    | Node (n, t0, t1) ->
+        aux (n :: tested) (d+1) t0; aux (n :: tested) (d+1) t1 in
+    aux [] 0 t;
+    Hashtbl.fold (fun x k l -> (x, k) :: l) h [];;
+
+(* maximum and average of the numbers of tests of the cases *)
+let report leaf_tests t =
+  match tests leaf_tests t with
+    | [] -> (0, 0.)
+    | l ->
+        let m = List.fold_left (fun m (_, k) -> max m k) 0 l
+        and s = List.fold_left (fun s (_, k) -> s + k) 0 l in
+          (m, float_of_int s /. float_of_int (List.length l));;
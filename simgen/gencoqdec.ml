@@ -98,19 +98,33 @@ let pos_info (_, pc) =
  * That is to say, we generate the "pattern"
 (* The bits are separated by ' *)
  *)
-let gen_pattern (lh ,ls) =
+(* the elements of the pattern, bit 0 first *)
+let pattern_elements (lh, ls) =
   let x = pos_info (lh, ls) in
+    match add_mode lh with
+      | DecInstARMUncond -> Array.to_list (gen_pattern_get_array x)
+      | DecInstARMCond -> begin match name (lh ,ls) with
+          | "BKPT" :: _ -> Array.to_list (Array.sub x 0 28)
+          | _ -> Array.to_list x
+        end
+      | DecMode _ | DecInstThumb | DecEncoding -> Array.to_list x;;
+
+(* if values is false, the bits having a fixed value, which are tested
+   by the decision tree, are not matched again (see dec_case) *)
+let gen_pattern_aux values (lh ,ls) =
   let dec b ls =
     match ls with
       | (Value s, _) ->
-          begin match s with
-            | true -> string b "1 "
-            | false -> string b "0 "
+          begin match values, s with
+            | false, _ -> string b "_ "
+            | true, true -> string b "1 "
+            | true, false -> string b "0 "
           end
       | (Shouldbe s, i) ->
-          begin match s with
-            | true -> bprintf b "SBO%d " i
-            | false -> bprintf b "SBZ%d " i
+          begin match values, s with
+            | false, _ -> string b "_ "
+            | true, true -> bprintf b "SBO%d " i
+            | true, false -> bprintf b "SBZ%d " i
           end
       | (Param1 c, _) -> bprintf b "%c_ " c (*REMOVE: (Char.escaped c)*)
       | (Param1s s, _) -> bprintf b "%s " s
@@ -118,22 +132,27 @@ let gen_pattern (lh ,ls) =
       | (Range _, _) -> string b "_ "
       | (Nothing, _) -> ()
   in
-  let aux b =
-    match add_mode lh with
-      | DecInstARMUncond -> 
-          let lst = Array.to_list (gen_pattern_get_array x) in
-            (list dec) b (List.rev lst)
-      | DecInstARMCond -> begin match name (lh ,ls) with
-          | "BKPT" :: _ -> let lst = Array.to_list (Array.sub x 0 28) in
-              (list dec) b (List.rev lst)
-          | _ -> let lst = Array.to_list x in
-              (list dec) b (List.rev lst)
-        end
-      | DecMode _ | DecInstThumb | DecEncoding ->
-          let lst = Array.to_list x in
-            (list dec) b (List.rev lst)
+  let aux b = (list dec) b (List.rev (pattern_elements (lh, ls)))
   in aux;;
 
+let gen_pattern = gen_pattern_aux true;;
+
+(* bits having a fixed value in the pattern, for the decision tree *)
+let fixed_bits (lh, ls) =
+  List.fold_right (fun e l ->
+    match e with
+      | (Value s, i) -> (i, s) :: l
+      | ((Shouldbe _ | Param1 _ | Param1s _ | Range _ | Nothing), _) -> l)
+    (pattern_elements (lh, ls)) [];;
+
+(* tell if the pattern binds variables used by the result *)
+let has_vars (lh, ls) =
+  List.exists (fun e ->
+    match e with
+      | ((Param1 _ | Param1s _), _) -> true
+      | ((Value _ | Shouldbe _ | Range _ | Nothing), _) -> false)
+    (pattern_elements (lh, ls));;
+
 (*****************************************************************************)
 (** remove unused parameters from instructions and addressing mode cases *)
 (*****************************************************************************)
@@ -345,28 +364,45 @@ let mode_tst (lh, ls) c =
 let unconditional_instr =
  ["BLX1"; "CPS"; "PLD"; "RFE"; "SETEND"; "SRS"];;
 
+(* the result of a case, None if the case is not decoded *)
+let dec_body (lh, ls) =
+  match add_mode lh with
+    | DecInstARMCond -> Some (mode_tst (lh, ls) true)
+    | DecInstARMUncond -> Some (mode_tst (lh, ls) false)
+    | DecInstThumb -> None (* TODO: Thumb mode *)
+    | DecEncoding -> None
+    | DecMode i ->
+        (*FIXME*)
+        if i = 1 || (i = 2 && false) || (i = 3 && false) then
+          Some (fun b -> bprintf b "DecInst _ (%s %t)"
+                  (id_addr_mode (lh, ls)) (params string (lh, ls)))
+        else
+          Some (fun b -> bprintf b "decode_cond w (fun condition => %s %t)"
+                  (id_addr_mode (lh, ls)) (params string (lh, ls)));;
+
 let dec_inst b (lh, ls) =
-  let md = add_mode lh in
-    match md with
-      | DecInstARMCond ->
-          bprintf b "    %a\n    | word%s %t=>\n      %t\n"
-            comment lh word_size (gen_pattern (lh, ls)) (mode_tst (lh, ls) true)
-      | DecInstARMUncond -> 
-          bprintf b "    %a\n    | word%s %t=>\n      %t\n"
-            comment lh word_size (gen_pattern (lh, ls)) (mode_tst (lh, ls) false)
-      | DecInstThumb -> () (* TODO: Thumb mode *)
-      | DecEncoding -> ()
-      | DecMode i ->
-          (*FIXME*)
-          if i = 1 || (i = 2 && false) || (i = 3 && false) then
-            bprintf b "    %a\n    | word%s %t=>\n      DecInst _ (%s %t)\n"
-              comment lh word_size (gen_pattern (lh, ls))
-              (id_addr_mode (lh, ls)) (params string (lh, ls))
-          else
-            bprintf b "    %a\n    | word%s %t=>\n      decode_cond w (fun condition => %s %t)\n"
-              comment lh word_size (gen_pattern (lh ,ls))
-              (id_addr_mode (lh, ls)) (params string (lh, ls))
-;;
+  match dec_body (lh, ls) with
+    | Some body ->
+        bprintf b "    %a\n    | word%s %t=>\n      %t\n"
+          comment lh word_size (gen_pattern (lh, ls)) body
+    | None -> ();;
+
+(* a case of the decision tree: its variables are bound by a pattern
+   matching on the same tuple as in dec_inst *)
+let dec_case b (lh, ls) =
+  let result b body =
+    if has_vars (lh, ls) then
+      bprintf b "fun x w => match x with word%s %t=> %t end"
+        word_size (gen_pattern_aux false (lh, ls)) body
+    else bprintf b "fun _ w => %t" body
+  in
+  match dec_body (lh, ls) with
+    | Some body ->
+        bprintf b "    %a\n    mk_dcase (%a nil)\n      (%a) ::\n"
+          comment lh
+          (list (fun b (i, s) -> bprintf b "(n%d, %b) :: " i s)) (fixed_bits (lh, ls))
+          result body
+    | None -> ();;
 
 (*****************************************************************************)
 (** ordering *)
@@ -427,4 +463,76 @@ let decode b ps =
   List.iter (bprintf b "%s\n") decode_body;
 ;;
 
+(*****************************************************************************)
+(** decoder using decision trees (option -ocoq-dec-tree) *)
+(*****************************************************************************)
+
+(* Each decoder is given by the list of its cases, in the same order as
+   the pattern matching above, and evaluated with a decision tree
+   testing one bit at each node (see coq/Dtree.v). The bits tested are
+   chosen here (see dectree.ml), and the tree is built in Coq from them.
+   The lemmas generated for each decoder state that it gives the result
+   of the first matching case, and the same result as the pattern
+   matching generated by -ocoq-dec, which is kept under the name
+   X_match. The latter is proved by case analysis on the bits tested
+   by the two decoders. *)
+
+let rec shape b = function
+  | Dectree.Leaf _ -> string b "SLeaf"
+  | Dectree.Node (n, t0, t1) -> bprintf b "(SNode n%d %a %a)" n shape t0 shape t1;;
+
+(* bit n of the tuple matched by the decoders, the number n being
+   matched when the tree is built *)
+let word_bit b =
+  let size = int_of_string word_size in
+  let field i b =
+    for j = size - 1 downto 0 do
+      string b (if i = j then "b " else "_ ")
+    done in
+    bprintf b "\n\nDefinition w%s_bit (n : nat) : w%s -> bool :=\n  match n with\n"
+      word_size word_size;
+    for i = 0 to size - 1 do
+      bprintf b "    | %d%%nat => fun x => match x with word%s %t=> b end\n"
+        i word_size (field i)
+    done;
+    bprintf b "    | _ => fun _ => false\n  end.";;
+
+let dec_tree b fname typ default cases =
+  let cases = List.filter (fun p ->
+    match dec_body p with Some _ -> true | None -> false) cases in
+  let _, numbered = List.fold_left (fun (i, l) p -> (i+1, (i, fixed_bits p) :: l))
+    (0, []) cases in
+  let t = Dectree.build true (List.rev numbered) in
+  let m, avg = Dectree.report Dectree.first_leaf_tests t in
+    bprintf b "\n\nDefinition %s_match (w : word) : decoder_result %s :=\n  match w%s_of_word w with\n" fname typ word_size;
+    list dec_inst b cases;
+    bprintf b "    | _ => %s\n  end." default;
+    bprintf b "\n\nDefinition %s_cases : list (dcase w%s (decoder_result %s)) :=\n" fname word_size typ;
+    list dec_case b cases;
+    bprintf b "    nil.\n\n(* %d nodes, depth %d, at most %d bit tests per case, %.1f on average *)\nDefinition %s_tree :=\n  dtree_build w%s_bit %a %s_cases.\n\n" (Dectree.nb_nodes t) (Dectree.depth t) m avg fname word_size shape t fname;
+    bprintf b "Definition %s (w : word) : decoder_result %s :=\n  dtree_eval %s_tree (w%s_of_word w) w (%s).\n\n" fname typ fname word_size default;
+    bprintf b "Lemma %s_first_match : forall w,\n  %s w = first_match w%s_bit %s_cases (w%s_of_word w) w (%s).\n\nProof.\n  intro w. unfold %s, %s_tree. apply dtree_build_ok.\nQed.\n\n" fname fname word_size fname word_size default fname fname;
+    bprintf b "Lemma %s_ok : forall w, %s w = %s_match w.\n\nProof.\n  intro w. rewrite %s_first_match. unfold %s_match, %s_cases.\n  destruct (w%s_of_word w). simpl.\n  repeat (match goal with |- context [if ?b then _ else _] =>\n    is_var b; destruct b; simpl end); reflexivity.\nQed." fname fname fname fname fname fname word_size;;
+
+let decode_tree b ps =
+  bprintf b "Require Import Dtree Bitvec %sFunctions Semantics %s %sMessage.\nImport Semantics.Decoder. Import Semantics.S.Decoder_result. " prefix_proc prefix_inst prefix_proc;
+  word_bit b;
+  bprintf b "\n\nLocal Notation \"0\" := false.\nLocal Notation \"1\" := true.";
+
+  for i = 1 to nb_buff do
+    dec_tree b (sprintf "decode_addr_mode%d" i) (sprintf "mode%d" i)
+      (sprintf "DecError mode%d NotAnAddressingMode%d" i i)
+      (sort_add_mode_cases i (List.filter (is_addr_mode i) ps))
+  done;
+
+  let dec_tree_cond msg cond_or_uncond =
+    dec_tree b (sprintf "decode_%sconditional" msg) "inst"
+      "DecUndefined_with_num inst 0" (sort_inst (List.filter cond_or_uncond ps)) in
+  dec_tree_cond "un" is_uncond_inst;
+  if display_cond then dec_tree_cond "" is_cond_inst;
+
+  bprintf b "\n\nDefinition decode ";
+  List.iter (bprintf b "%s\n") decode_body;
+;;
+
 end
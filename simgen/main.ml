@@ -24,14 +24,15 @@ let get_norm, set_norm = get_set_bool();;
 let get_check, set_check = get_set_bool();;
 let get_sh4, set_sh4 = get_set_bool ()
 let get_coq, set_coq = get_set_bool();;
+let get_threaded, set_threaded = get_set_bool();;
 
 let set_debug() = ignore(Parsing.set_trace true); set_debug(); set_verbose();;
 
 let set_check() = set_check(); set_verbose();;
 
 type output_type =
-  | PCout | Cxx | C4dt | CoqInst | CoqDec | MlDec | DecBinTest | DecAsmTest
-  | DecTest | RawCoq_Csyntax | CompcertCInst;;
+  | PCout | Cxx | C4dt | CoqInst | CoqDec | CoqDecTree | MlDec | DecBinTest
+  | DecAsmTest | DecTest | RawCoq_Csyntax | CompcertCInst;;
 
 let is_set_pc_input_file, get_pc_input_file, set_pc_input_file =
   is_set_get_set "input file name for -ipc option" "";;
@@ -127,6 +128,16 @@ let rec options() =
   "prefix : generate various C files implementing a simulator (in conjunction with -ipc and -idec) (implies -norm)";
   "-oc4dt", String (fun s -> set_norm(); set_output_type C4dt; set_output_file s),
   "prefix : generate various C/C++ files implementing a simulator with dynamic translation (in conjonction with -ipc, -isyntax and -idec) (implies -norm)";
+  "-fast-mem", Unit set_fast_mem,
+  ": the semantics functions use the inline memory accessors of simlight2 (in conjunction with -oc4dt only)";
+  "-packed-cpsr", Unit set_packed_cpsr,
+  ": the semantics functions use the packed layout of the status registers of simlight2, which must then be compiled with -DSLV6_PACKED_CPSR (in conjunction with -oc4dt only)";
+  "-lazy-flags", Unit (fun () -> set_packed_cpsr(); set_lazy_flags()),
+  ": same as -packed-cpsr, and the flags set by additions, subtractions and logical operations are computed only when they are read; simlight2 must then be compiled with -DSLV6_PACKED_CPSR -DSLV6_LAZY_FLAGS (in conjunction with -oc4dt only)";
+  "-thumb-table", Unit set_thumb_table,
+  ": the Thumb decoders of simlight2 use a table of the 65536 decoded Thumb instructions; simlight2 must then be compiled with -DSLV6_THUMB_TABLE (in conjunction with -oc4dt only)";
+  "-oc4dt-threaded", String (fun s -> set_norm(); set_threaded(); set_output_type C4dt; set_output_file s),
+  "prefix : same as -oc4dt, and generate also a direct-threaded interpreter using the GCC extension \"labels as values\" (implies -norm)";
   "-ocoq-inst", Unit (fun () -> set_norm(); set_output_type CoqInst),
   ": output on stdout Coq code defining the semantics of instructions (in conjunction with -ipc) (implies -norm)";
   "-ocompcertc-inst", Unit (fun () -> set_norm(); set_output_type CompcertCInst),
@@ -135,6 +146,8 @@ let rec options() =
   "file.c : output on stdout Coq code representing the C code given in input using the CompCert library";
   "-ocoq-dec", Unit (fun () -> set_output_type CoqDec),
   ": output on stdout Coq code for decoding instructions (in conjunction with -idec only)";
+  "-ocoq-dec-tree", Unit (fun () -> set_output_type CoqDecTree),
+  ": same as -ocoq-dec but the decoders use decision trees on the bits of the instruction";
   "-oml-dec", Unit (fun () -> set_output_type MlDec),
   ": output on stdout Ocaml code for decoding instructions (in conjunction with -idec only)";
   "-obin-test", Unit (fun () -> set_norm(); set_output_type DecBinTest),
@@ -189,6 +202,8 @@ let parse_args() =
         ()
     | CoqDec ->
         ignore (get_dec_input_file())
+    | CoqDecTree ->
+        ignore (get_dec_input_file())
     | MlDec ->
         ignore (get_dec_input_file())
     | DecBinTest ->
@@ -340,6 +355,7 @@ let genr_output() =
        Simlight2.lib) (get_output_file())
         (get_pc_input()) (get_syntax_input()) (get_dec_input())
         (if is_set_weight_file() then Some (get_weight_file()) else None)
+        (get_threaded())
 
     | CoqInst -> print (Gencoq.lib (if get_sh4() then
         (module struct
@@ -376,6 +392,15 @@ let genr_output() =
                (module Arm6 : DEC)) : DEC)) in
              Gencoqdec.decode) (get_dec_input())
 
+    | CoqDecTree ->
+      print (let open Dec in
+             let module Gencoqdec = Gencoqdec.Make ((val (
+             if get_sh4 () then
+               (module Sh4 : DEC) 
+             else
+               (module Arm6 : DEC)) : DEC)) in
+             Gencoqdec.decode_tree) (get_dec_input())
+
     | MlDec ->
         print Genmldec.decode (get_dec_input())
 
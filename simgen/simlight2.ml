@@ -65,6 +65,8 @@ See the COPYRIGHTS and LICENSE files.
      We need 2 versions:
      o one version with an expanded list of atomic arguments
      o one version taking an SLv6_Instruction* as argument
+   - Optionally, we generate a direct-threaded interpreter, which inlines
+     a third version of the semantics functions
 *)
 
 module Make (Gencxx : Gencxx.GENCXX) = 
@@ -113,7 +115,10 @@ let gen_tables b (xs: xprog list) =
   let fct b x = bprintf b "\n  slv6_G_%s" x.xprog.fid in
   let undef_fct = "\n  NULL" in
   bprintf b "SemanticsFunction slv6_instruction_functions[SLV6_TABLE_SIZE] = {";
-  bprintf b "%a,%s};\n" (list_sep "," fct) xs undef_fct;;
+  bprintf b "%a,%s};\n\n" (list_sep "," fct) xs undef_fct;
+  let base b x = bprintf b "\n  %d" x.xbase in
+  bprintf b "const uint16_t slv6_weight_index[SLV6_INSTRUCTION_COUNT] = {";
+  bprintf b "%a};\n" (list_sep "," base) xs;;
 
 (* generate the numerical instruction identifier *)
 let gen_ids b xs =
@@ -153,6 +158,9 @@ let may_branch_prog b (x: xprog) =
   else if x.xprog.finstr = "MSRreg" then
     bprintf b "  case SLV6_%s_ID: return instr->args.%s.field_mask&1;\n"
       x.xprog.fid (union_id x)
+  (* special case for STC and LDC: replaced by an undefined instruction exception *)
+  else if x.xprog.finst = Proc ("exec_undefined_instruction", []) then
+    bprintf b "  case SLV6_%s_ID: return true;\n" x.xprog.fid
   (* special case for MCR[R]: modifying the system coprocessor state may have special effects *)
   else if x.xprog.finstr = "MCR" || x.xprog.finstr = "MCRR" then
     bprintf b "  case SLV6_%s_ID: return instr->args.%s.cp_num==15;\n"
@@ -204,6 +212,164 @@ let may_branch b xs =
   bprintf b "  case SLV6_UNPRED_OR_UNDEF_ID: return true;\n";
   bprintf b "  default: return false;\n  }\n}\n";;
 
+(** Generation of the functions used by the dead flag elimination *)
+(* The flags N, Z, C and V are represented by the bits 3, 2, 1 and 0 of a
+ * mask (see slv6_iss_h_prelude.h). For each instruction, we generate:
+ * - the flags it may read (slv6_flags_read);
+ * - the flags it surely sets (slv6_flags_written), which may depend on
+ *   the parameters of the instruction (e.g., bit S);
+ * - the flags it may set (slv6_flags_assigned) and the id of the variant
+ *   that does not set them (slv6_no_flags_id, see no_flags_variants). *)
+
+let flag_mask = function
+  | "N" -> 8
+  | "Z" -> 4
+  | "C" -> 2
+  | "V" -> 1
+  | _ -> 0;;
+
+(* boolean C expressions, simplified when possible *)
+let c_and c1 c2 =
+  if c1 = "0" || c2 = "0" then "0"
+  else if c1 = "1" then c2
+  else if c2 = "1" then c1
+  else sprintf "(%s && %s)" c1 c2;;
+
+let c_or c1 c2 =
+  if c1 = "1" || c2 = "1" then "1"
+  else if c1 = "0" then c2
+  else if c2 = "0" then c1
+  else if c1 = c2 then c1
+  else sprintf "(%s || %s)" c1 c2;;
+
+let c_not c =
+  if c = "0" then "1" else if c = "1" then "0" else sprintf "!%s" c;;
+
+(* C code of e if it depends only on the parameters of the instruction *)
+let rec static_exp x = function
+  | Var s when List.mem_assoc s x.xips ->
+      Some (sprintf "instr->args.%s.%s" (union_id x) s)
+  | Num n -> Some n
+  | BinOp (e1, ("=="|"!="|"and"|"or" as op), e2) -> (
+      match static_exp x e1, static_exp x e2 with
+        | Some s1, Some s2 ->
+            let op = match op with "and" -> "&&" | "or" -> "||" | op -> op in
+              Some (sprintf "(%s%s%s)" s1 op s2)
+        | _ -> None)
+  | Fun ("not", [e]) -> option_map (sprintf "!%s") (static_exp x e)
+  | _ -> None;;
+
+(* condition under which the flag f is surely set by i *)
+let rec written x f = function
+  | Block is -> List.fold_left (fun c i -> c_or c (written x f i)) "0" is
+  | Assign (CPSR, _) -> "1"
+  | Assign _ as i -> if assigned_nzcv i = Some f then "1" else "0"
+  | If (c, i1, oi2) ->
+      let w1 = written x f i1
+      and w2 = match oi2 with Some i2 -> written x f i2 | None -> "0" in (
+        match static_exp x c with
+          | Some c -> c_or (c_and c w1) (c_and (c_not c) w2)
+          | None -> c_and w1 w2)
+  | _ -> "0";;
+
+(* mask of the flags that may be read by i *)
+let read_mask i =
+  let rec exp e = match nzcv_of_exp e with
+    | Some f -> flag_mask f
+    | None -> match e with
+        | CPSR -> 15
+        | If_exp (e1, e2, e3) -> exp e1 lor exp e2 lor exp e3
+        | Fun (_, es) -> exps es
+        | BinOp (e1, _, e2) -> exp e1 lor exp e2
+        | Reg (e, _) | Memory (e, _) -> exp e
+        | Ast.Range (e, Index e') -> exp e lor exp e'
+        | Ast.Range (e, _) -> exp e
+        | Coproc_exp (e, _, es) -> exps (e :: es)
+        | _ -> 0
+  and exps es = List.fold_left (fun m e -> m lor exp e) 0 es in
+  (* assigning a part of the CPSR does not read it *)
+  let dst = function
+    | CPSR | Ast.Range (CPSR, _) -> 0
+    | e -> exp e in
+  let rec inst = function
+    | Block is -> List.fold_left (fun m i -> m lor inst i) 0 is
+    | Assign (d, e) -> dst d lor exp e
+    | If (e, i, None) | While (e, i) -> exp e lor inst i
+    | If (e, i1, Some i2) -> exp e lor inst i1 lor inst i2
+    | For (_, _, _, i) -> inst i
+    | Case (e, sis, oi) ->
+        List.fold_left (fun m (_, i) -> m lor inst i)
+          (exp e lor (match oi with Some i -> inst i | None -> 0)) sis
+    | Proc ("exec_undefined_instruction", _) -> 15
+    | Proc (_, es) -> exps es
+    | Coproc (e, _, es) -> exps (e :: es)
+    | Assert e | Return e -> exp e
+    | _ -> 0
+  in inst i;;
+
+(* mask of the flags that may be set by i, without CPSR assignments *)
+let assigned_mask i =
+  let flags = ref 0 in
+  let pi i = (match assigned_nzcv i with
+    | Some f -> flags := !flags lor flag_mask f
+    | None -> ());
+    false in
+    ignore (inst_exists pi ffalse ffalse i); !flags;;
+
+let flags_read_prog b (x: xprog) =
+  let r = read_mask x.xprog.finst in
+    if is_conditional x then
+      bprintf b "  case SLV6_%s_ID: return instr->args.%s.cond==SLV6_AL ? %d : 15;\n"
+        x.xprog.fid (union_id x) r
+    else if r <> 0 then
+      bprintf b "  case SLV6_%s_ID: return %d;\n" x.xprog.fid r;;
+
+let flags_read b xs =
+  bprintf b "uint8_t slv6_flags_read(const struct SLv6_Instruction *instr) {\n";
+  bprintf b "  switch (instr->args.g0.id) {\n%a" (list flags_read_prog) xs;
+  bprintf b "  case SLV6_UNPRED_OR_UNDEF_ID: return 15;\n";
+  bprintf b "  default: return 0;\n  }\n}\n";;
+
+let flags_written_prog b (x: xprog) =
+  let cs = List.map (fun f -> f, written x f x.xprog.finst) ["N"; "Z"; "C"; "V"] in
+  let cs = List.filter (fun (_, c) -> c <> "0") cs in
+  (* group the flags having the same condition *)
+  let rec group = function
+    | (f, c) :: l ->
+        let same, others = List.partition (fun (_, c') -> c' = c) l in
+        let m = List.fold_left (fun m (f, _) -> m lor flag_mask f) (flag_mask f) same in
+          (m, c) :: group others
+    | [] -> [] in
+  let mask b (m, c) =
+    if c = "1" then bprintf b "%d" m else bprintf b "(%s ? %d : 0)" c m in
+    if cs <> [] then
+      let ms = group cs in
+        if is_conditional x then
+          bprintf b "  case SLV6_%s_ID:\n    return instr->args.%s.cond==SLV6_AL ? %a : 0;\n"
+            x.xprog.fid (union_id x) (list_sep "|" mask) ms
+        else
+          bprintf b "  case SLV6_%s_ID:\n    return %a;\n"
+            x.xprog.fid (list_sep "|" mask) ms;;
+
+let flags_written b xs =
+  bprintf b "uint8_t slv6_flags_written(const struct SLv6_Instruction *instr) {\n";
+  bprintf b "  switch (instr->args.g0.id) {\n%a" (list flags_written_prog) xs;
+  bprintf b "  default: return 0;\n  }\n}\n";;
+
+let no_flags_tables b xs =
+  let rec number i = function
+    | x :: l -> (x.xprog.fid, i) :: number (i+1) l
+    | [] -> [] in
+  let ids = number 0 xs in
+  let no_flags_id b x =
+    let id = List.assoc x.xprog.fid ids in
+      bprintf b "\n  %d" (try List.assoc (x.xprog.fid^"_NF") ids with Not_found -> id)
+  and assigned b x = bprintf b "\n  %d" (assigned_mask x.xprog.finst) in
+  bprintf b "const uint16_t slv6_no_flags_id[SLV6_INSTRUCTION_COUNT] = {";
+  bprintf b "%a};\n\n" (list_sep "," no_flags_id) xs;
+  bprintf b "const uint8_t slv6_flags_assigned[SLV6_INSTRUCTION_COUNT] = {";
+  bprintf b "%a};\n" (list_sep "," assigned) xs;;
+
 (** print sizeof(T) for each instruction type T *)
 
 let dump_sizeof bn gs =
@@ -224,8 +390,8 @@ let dump_sizeof bn gs =
 (** Generation of the LLVM generator *)
 
 (* We generate only the function "generate_one_instruction",
-   which is included in the file "arm_v6_llvm_generator.cpp".
-   The generated file cannot be compiled outside SimSoC. *)
+   which is included in the file "arm_v6_llvm_generator.cpp" of SimSoC,
+   and in the file "arm6/simlight2/slv6_jit.cpp". *)
 
 let llvm_generator bn xs =
   let case b (x: xprog) = 
@@ -265,6 +431,48 @@ let llvm_generator bn xs =
   let out = open_out (bn^"-llvm_generator.hpp") in
     Buffer.output_buffer out b; close_out out;;
 
+(** Generation of the direct-threaded interpreter *)
+
+(* The instructions of a basic block are stored in an array, followed by
+   an end marker. The field "label" of each instruction contains the
+   address of the code simulating it, inside the function
+   slv6_threaded_exec. After each instruction, we jump directly to the
+   label of the next one, using the "labels as values" extension of GCC.
+   Only the last instruction of a block may modify the PC, so the jump
+   test is done once, at the end marker. *)
+
+let threaded_interpreter bn xs =
+  let b = Buffer.create 10000 in
+  let label b x = bprintf b "\n    &&L_%s," x.xprog.fid in
+  let handler b x =
+    bprintf b " L_%s:\n  slv6_T_%s(proc,instr);\n  NEXT;\n" x.xprog.fid x.xprog.fid in
+    bprintf b "#include \"%s_c_prelude.h\"\n" bn;
+    bprintf b "\n%a" (list_sep "\n" prog_threaded) xs;
+    bprintf b "\n#define NEXT ++instr; proc->regs[15] += size; goto *instr->label\n";
+    bprintf b "\nstatic const void **labels = NULL;\n";
+    bprintf b "\n/* if proc is NULL, only initialize the table of labels */\n";
+    bprintf b "void slv6_threaded_exec(struct SLv6_Processor *proc,\n";
+    bprintf b "                        struct SLv6_Instruction *instr, uint32_t size) {\n";
+    bprintf b "  static const void *table[SLV6_THREADED_END_ID+1] = {%a" (list label) xs;
+    bprintf b "\n    &&L_undef_or_unpred,\n    &&L_end};\n";
+    bprintf b "  if (!proc) {labels = table; return;}\n";
+    bprintf b "  goto *instr->label;\n";
+    bprintf b "%a" (list handler) xs;
+    bprintf b " L_undef_or_unpred:\n";
+    bprintf b "  TODO(\"Unpredictable or undefined instruction\");\n";
+    bprintf b " L_end:\n";
+    bprintf b "  /* the PC has been incremented after the last instruction */\n";
+    bprintf b "  if (proc->jump) {\n";
+    bprintf b "    proc->jump = false;\n";
+    bprintf b "    proc->regs[15] -= size;\n  }\n}\n";
+    bprintf b "\nconst void *slv6_threaded_label(uint16_t id) {\n";
+    bprintf b "  assert(id<=SLV6_THREADED_END_ID);\n";
+    bprintf b "  if (!labels) slv6_threaded_exec(NULL,NULL,0);\n";
+    bprintf b "  return labels[id];\n}\n";
+    bprintf b "\nEND_SIMSOC_NAMESPACE\n";
+    let outc = open_out (bn^"_threaded.c") in
+      Buffer.output_buffer outc b; close_out outc;;
+
 (* temporary functions *)
 
 let print_stat k xs =
@@ -283,9 +491,10 @@ let print_stat k xs =
 
 (** main function *)
 
-(* bn: output file basename, pcs: pseudo-code trees, decs: decoding rules *)
+(* bn: output file basename, pcs: pseudo-code trees, decs: decoding rules,
+   wf: weight file, threaded: generate the direct-threaded interpreter *)
 let lib (bn: string) ({ body = pcs ; _ } : program) (ss: syntax list)
-    (decs: Codetype.maplist) (wf: string option) =
+    (decs: Codetype.maplist) (wf: string option) (threaded: bool) =
   let pcs': prog list = postpone_writeback pcs in
   let fs4: fprog list = List.rev (flatten pcs' ss decs) in
     (* remove MOV (3) thumb instruction, because it is redundant with CPY. *)
@@ -305,16 +514,43 @@ let lib (bn: string) ({ body = pcs ; _ } : program) (ss: syntax list)
     bprintf bh "#ifndef SLV6_ISS_H\n#define SLV6_ISS_H\n\n";
     bprintf bh "#include \"%s_h_prelude.h\"\n" bn;
     (match wf with Some _ -> bprintf bh "\n#define SLV6_USE_WEIGHTS 1\n" | None -> ());
+    (* the layout of the status registers (see slv6_status_register.h) must
+     * be the one used by the semantics functions *)
+    if get_packed_cpsr () then
+      bprintf bh "\n#ifndef SLV6_PACKED_CPSR\n#error \"generated by simgen -packed-cpsr: compile with -DSLV6_PACKED_CPSR\"\n#endif\n"
+    else
+      bprintf bh "\n#ifdef SLV6_PACKED_CPSR\n#error \"generated without simgen option -packed-cpsr\"\n#endif\n";
+    if get_lazy_flags () then
+      bprintf bh "\n#ifndef SLV6_LAZY_FLAGS\n#error \"generated by simgen -lazy-flags: compile with -DSLV6_LAZY_FLAGS\"\n#endif\n"
+    else
+      bprintf bh "\n#ifdef SLV6_LAZY_FLAGS\n#error \"generated without simgen option -lazy-flags\"\n#endif\n";
     bprintf bh "\n#define SLV6_INSTRUCTION_COUNT %d\n" instr_count;
     bprintf bh "\n#define SLV6_TABLE_SIZE (SLV6_INSTRUCTION_COUNT+11)\n\n";
     bprintf bh "extern const char *slv6_instruction_names[SLV6_TABLE_SIZE];\n";
     bprintf bh "extern const char *slv6_instruction_references[SLV6_TABLE_SIZE];\n";
     bprintf bh "extern SemanticsFunction slv6_instruction_functions[SLV6_TABLE_SIZE];\n";
+    (* position in the weight file of the instruction from which each
+     * instruction is derived (see slv6_profile.h) *)
+    bprintf bh "\n#define SLV6_WEIGHT_COUNT %d\n" (List.length fs);
+    bprintf bh "extern const uint16_t slv6_weight_index[SLV6_INSTRUCTION_COUNT];\n";
+    (* tables used by the dead flag elimination (see slv6_basic_block.c) *)
+    bprintf bh "\nextern const uint16_t slv6_no_flags_id[SLV6_INSTRUCTION_COUNT];\n";
+    bprintf bh "extern const uint8_t slv6_flags_assigned[SLV6_INSTRUCTION_COUNT];\n";
     bprintf bh "\n%a" gen_ids all_xs;
+    if threaded then (
+      bprintf bh "\n#define SLV6_THREADED 1\n";
+      bprintf bh "#define SLV6_THREADED_END_ID (SLV6_INSTRUCTION_COUNT+1)\n\n";
+      bprintf bh "extern void slv6_threaded_exec(struct SLv6_Processor*,\n";
+      bprintf bh "                               struct SLv6_Instruction*, uint32_t size);\n";
+      bprintf bh "extern const void *slv6_threaded_label(uint16_t id);\n"
+    );
     (* generate the instruction type *)
     bprintf bh "\n%a" (list_sep "\n" group_type) groups;
     bprintf bh "\nstruct SLv6_Instruction {\n";
-    bprintf bh "  SemanticsFunction sem_fct;\n";
+    if threaded then
+      bprintf bh "  union {\n    SemanticsFunction sem_fct;\n    const void *label;\n  };\n"
+    else
+      bprintf bh "  SemanticsFunction sem_fct;\n";
     bprintf bh "  union {\n%a" (list union_field) groups;
     bprintf bh "    struct ARMv6_InstrBasicBlock basic_block;\n";
     bprintf bh "    struct ARMv6_InstrOptimizedBasicBlock opt_basic_block;\n";
@@ -330,6 +566,10 @@ let lib (bn: string) ({ body = pcs ; _ } : program) (ss: syntax list)
     bprintf bc "\n%a" gen_tables all_xs;
     (* generate the may_branch function *)
     bprintf bc "\n%a" may_branch all_xs;
+    (* generate the functions used by the dead flag elimination *)
+    bprintf bc "\n%a" flags_read all_xs;
+    bprintf bc "\n%a" flags_written all_xs;
+    bprintf bc "\n%a" no_flags_tables all_xs;
     (* close the namespace (opened in ..._c_prelude.h *)
     bprintf bc "\nEND_SIMSOC_NAMESPACE\n";
     (* write buffers to files *)
@@ -352,6 +592,8 @@ let lib (bn: string) ({ body = pcs ; _ } : program) (ss: syntax list)
     printers bn all_xs;
     (* Now, we generate the semantics functions. *)
     semantics_functions bn all_xs "expanded" decl_expanded prog_expanded;
-    semantics_functions bn all_xs "grouped" decl_grouped prog_grouped;;
+    semantics_functions bn all_xs "grouped" decl_grouped prog_grouped;
+    (* generate the direct-threaded interpreter *)
+    if threaded then threaded_interpreter bn all_xs;;
 
 end
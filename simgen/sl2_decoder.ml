@@ -17,27 +17,47 @@ open Flatten;;
 open Util;;
 open Printf;;
 
-(* Each decoder starts with a switch on the following opcode:
- * - ARM: (cond<>15) followed by bits 27 to 20 (9 bits, 512 cases)
- * - Thumb: bits 15 to 11 (5 bits, 32 cases)
- *) 
+(* Each decoder is a decision tree (see dectree.ml) testing one bit of
+ * bincode at each node. The bits tested are chosen among the bits fixed
+ * by the coding tables. In each leaf, all the instructions compatible
+ * with the bits tested from the root are tried, so that the decoder
+ * still checks that at most one instruction matches.
+ * The ARM decoders first test if cond is 1111: the unconditional
+ * instructions are only tried in this case, and the conditional ones
+ * in the other case, so that each branch has its own tree. *)
 
-let binary k i =
+(* tell if an ARM instruction is conditional, i.e. if its coding table
+ * does not fix cond to 1111 *)
+let is_conditional p =
+  let d = p.xprog.fdec and v1 = Codetype.Value true in
+    not (d.(31)=v1 && d.(30)=v1 && d.(29)=v1 && d.(28)=v1);;
+
+(* the bits fixed by the coding table of p *)
+let fixed_bits p =
   let is_set n w =
     Int32.logand Int32.one (Int32.shift_right_logical w n) <> Int32.zero in
-  let n = match k with ARM -> 9 | Thumb -> 5 in
-  let s = String.make n '0' in
-    for b = 0 to n-1 do
-      if is_set b (Int32.of_int i) then (s.[n-b-1] <- '1')
-    done; s;;
+  let mask, value = Gencxx.mask_value p.xprog.fdec in
+  let rec aux n =
+    if n < 0 then []
+    else if is_set n mask then (n, is_set n value) :: aux (n-1)
+    else aux (n-1)
+  in aux 31;;
+
+(* number of mask/value tests in a leaf, done for every instruction of
+ * the leaf *)
+let leaf_tests tested cases =
+  let k = List.length (List.filter (fun (_, bits) ->
+    List.exists (fun (n, _) -> not (List.mem n tested)) bits) cases) in
+    List.map (fun _ -> k) cases;;
 
 (** Generation of the decoder *)
 
 module type DecoderConfig = sig
   (* the version, such as "decode_exec" or "decode_store" *)
   val version: string;;
-  (* the profile of the main decoder functions *)
-  val main_prof: Buffer.t -> fkind -> unit;;
+  (* the profile of the main decoder functions, the string being added
+   * to their names *)
+  val main_prof: Buffer.t -> (fkind * string) -> unit;;
   (* the profile of the specific instruction decoder functions *)
   val instr_prof: Buffer.t -> (fkind * string) -> unit;;
   (* how to call an instruction decoder function *)
@@ -46,6 +66,12 @@ module type DecoderConfig = sig
   val action: Buffer.t -> xprog ->unit;;
   (* what we do when we return from the decoder *)
   val return_action: string;;
+  (* with -thumb-table, the Thumb decoder uses the table of the decoded
+   * instructions (slv6_thumb_table) built by the decode_store version
+   * with its decision tree; table_tree tells if the decision tree is
+   * needed, and table_main prints the main function *)
+  val table_tree: bool;;
+  val table_main: Buffer.t -> unit;;
 end;;
 
 module DecoderGenerator (DC: DecoderConfig) = struct
@@ -54,33 +80,51 @@ module DecoderGenerator (DC: DecoderConfig) = struct
   (*  * - is: the instructions *)
   let decoder bn (k: fkind) (is: xprog list) =
 
-    let class_count = match k with ARM -> 512 | Thumb -> 32 in
-    let classes = Array.create class_count [] in
-    let classify p =
-      let is_conditional p = let d = p.xprog.fdec and v1 = Codetype.Value true in
-        not (d.(31)=v1 && d.(30)=v1 && d.(29)=v1 && d.(28)=v1) in
-      let mask, value = Gencxx.mask_value p.xprog.fdec in 
-      let opmask, opcode = match k with
-        | Thumb ->
-            let aux w = Int32.shift_right_logical w 11 in aux mask, aux value
-        | ARM ->
-            let aux w =
-              let w' = Int32.shift_right_logical (Int32.shift_left w 4) 24 in
-                if is_conditional p then w' else Int32.logor w' (Int32.of_int 0x100)
-            in aux mask, aux value
-      in for i = 0 to class_count -1 do
-          if Int32.logand (Int32.of_int i) opmask = opcode
-          then classes.(i) <- p :: classes.(i)
-          else ()
-        done
-    in List.iter classify is;
-
-    (* Phase A: check bits fixed by the coding table *)
-    let instA b p =
+    let table = k = Thumb && get_thumb_table() in
+    (* the instructions of a leaf are tried in the reverse order of is *)
+    let xs = Array.of_list (List.rev is) in
+    let cases = Array.to_list (Array.mapi (fun i p -> (i, fixed_bits p)) xs) in
+    let tree_of f = Dectree.build false (List.filter (fun (i, _) -> f xs.(i)) cases) in
+    (* the trees: for cond=1111 and for the other values (ARM), or a
+     * single tree (Thumb) *)
+    let trees = match k with
+      | ARM -> [ "cond=1111", tree_of (fun p -> not (is_conditional p));
+                 "cond<>1111", tree_of is_conditional ]
+      | Thumb -> [ "", tree_of (fun _ -> true) ] in
+    let s = if k = ARM then "arm" else "thumb" in
+    (* the test of cond is counted in the number of tests *)
+    let report (name, t) =
+      let m, avg = Dectree.report leaf_tests t
+      and d = if k = ARM then 1 else 0 in
+        sprintf "%s_%s%s: %d nodes, depth %d, at most %d tests per encoding, %.1f on average"
+          s DC.version (if name = "" then "" else " (" ^ name ^ ")")
+          (Dectree.nb_nodes t) (Dectree.depth t + d) (m + d) (avg +. float_of_int d) in
+    let reports = List.map report trees in
+      if not table || DC.table_tree then
+        List.iter (fun r -> verbose (r ^ "\n")) reports;
+
+    (* Phase A: check the bits fixed by the coding table which are not
+     * tested by the nodes *)
+    let instA ind tested b (i, _) =
+      let p = xs.(i) in
       let (mask, value) = Gencxx.mask_value p.xprog.fdec in
-      bprintf b "    if ((bincode&0x%08lx)==0x%08lx && %a) {\n"
-        mask value DC.instr_call p.xprog.fid;
-      bprintf b "      assert(!found); found = true;\n    }\n"
+      let mask = Int32.logand mask (Int32.lognot tested) in
+      let value = Int32.logand value mask in
+        if mask = Int32.zero then
+          bprintf b "%aif (%a) {\n" indent ind DC.instr_call p.xprog.fid
+        else
+          bprintf b "%aif ((bincode&0x%08lx)==0x%08lx && %a) {\n"
+            indent ind mask value DC.instr_call p.xprog.fid;
+        bprintf b "%a  assert(!found); found = true;\n%a}\n" indent ind indent ind
+    in
+    let rec tree ind tested b = function
+      | Dectree.Leaf cases -> list (instA ind tested) b cases
+      | Dectree.Node (n, t0, t1) ->
+          let bit = Int32.shift_left Int32.one n in
+          let tested = Int32.logor tested bit in
+            bprintf b "%aif (bincode&0x%08lx) {\n%a%a} else {\n%a%a}\n"
+              indent ind bit (tree (ind+2) tested) t1 indent ind
+              (tree (ind+2) tested) t0 indent ind
   in
     (* Phase B: extract parameters and check validity *)
   let instB b p =
@@ -113,40 +157,42 @@ module DecoderGenerator (DC: DecoderConfig) = struct
   in
   let b = Buffer.create 10000 in
     bprintf b "#include \"%s_c_prelude.h\"\n\n" bn;
-    bprintf b "%a\n" (list_sep "\n" instB) is;
-    bprintf b "/* the main function, used by the ISS loop */\n";
-    bprintf b "%a {\n" DC.main_prof k;
-    bprintf b "  bool found = false;\n";
-    ( match k with
-       | ARM ->
-           bprintf b "  const uint32_t c = bincode>>28;\n";
-           bprintf b
-             "  const uint32_t opcode = (c==15 ? 0x100 : 0) | (bincode<<4)>>24;\n"
-       | Thumb ->
-           bprintf b "  const uint16_t opcode = bincode>>11;\n"
+    if not table || DC.table_tree then (
+      bprintf b "%a\n" (list_sep "\n" instB) is;
+      if table then (
+        bprintf b "/* the decision tree, used to build the table */\n";
+        bprintf b "static %a {\n" DC.main_prof (k, "_tree")
+      ) else (
+        bprintf b "/* the main function, used by the ISS loop */\n";
+        bprintf b "%a {\n" DC.main_prof (k, "")
+      );
+      bprintf b "  bool found = false;\n";
+      List.iter (bprintf b "  /* %s */\n") reports;
+      (match trees with
+         | [ _, t15; _, t ] ->
+             let c = 0xf0000000l in
+               bprintf b "  if ((bincode&0x%08lx)==0x%08lx) {\n%a  } else {\n%a  }\n"
+                 c c (tree 4 c) t15 (tree 4 Int32.zero) t
+         | [ _, t ] -> bprintf b "%a" (tree 2 Int32.zero) t
+         | _ -> raise (Invalid_argument "Sl2_decoder.decoder"));
+      bprintf b "  %s\n}\n" DC.return_action
+    );
+    if table then (
+      bprintf b "\n/* the main function, used by the ISS loop */\n";
+      DC.table_main b
     );
-    bprintf b "  switch (opcode) {\n";
-    for i = 0 to class_count - 1 do
-      bprintf b "  case %d: /* %s */\n" i (binary k i);
-      if i+1=class_count || classes.(i) <> classes.(i+1) then
-        bprintf b "%a    break;\n" (list instA) classes.(i)
-      else ()
-    done;
-    bprintf b "  }\n";
-    bprintf b "  %s\n}\n" DC.return_action;
     bprintf b "\nEND_SIMSOC_NAMESPACE\n";
-    let s = if k = ARM then "arm" else "thumb" in
     let outc = open_out (bn^"_"^s^"_"^DC.version^".c") in
       Buffer.output_buffer outc b; close_out outc;;
 end;;
 
 module DecExecConfig = struct
   let version = "decode_exec";;
-  let main_prof b (k: fkind) =
+  let main_prof b ((k: fkind), suffix) =
     let s, n = if k = ARM then "arm", 32 else "thumb", 16 in
       bprintf b
-        "bool %s_decode_and_exec(struct SLv6_Processor *proc, uint%d_t bincode)"
-        s n;;
+        "bool %s_decode_and_exec%s(struct SLv6_Processor *proc, uint%d_t bincode)"
+        s suffix n;;
   let instr_prof b ((k: fkind), id) =
     bprintf b "bool try_exec_%s(struct SLv6_Processor *proc, uint%d_t bincode)"
       id (if k = ARM then 32 else 16);;
@@ -155,16 +201,23 @@ module DecExecConfig = struct
     let aux b (s,_) = bprintf b ",%s" s in
       bprintf b "  slv6_X_%s(proc%a);\n" x.xprog.fid (list aux) x.xips;;
   let return_action = "return found;"
+  let table_tree = false;;
+  let table_main b =
+    bprintf b "%a {\n" main_prof (Thumb, "");
+    bprintf b "  struct SLv6_Instruction *instr = &slv6_thumb_table[bincode];\n";
+    bprintf b "  if (instr->args.g0.id==SLV6_UNPRED_OR_UNDEF_ID) return false;\n";
+    bprintf b "  slv6_instruction_functions[instr->args.g0.id](proc,instr);\n";
+    bprintf b "  return true;\n}\n";;
 end;;
 module DecExec = DecoderGenerator(DecExecConfig);;
 
 module DecStoreConfig = struct
   let version = "decode_store";;
-  let main_prof b (k: fkind) =
+  let main_prof b ((k: fkind), suffix) =
     let s, n = if k = ARM then "arm", 32 else "thumb", 16 in
       bprintf b
-        "void %s_decode_and_store(struct SLv6_Instruction *instr, uint%d_t bincode)"
-        s n;;
+        "void %s_decode_and_store%s(struct SLv6_Instruction *instr, uint%d_t bincode)"
+        s suffix n;;
   let instr_prof b ((k: fkind), id) =
     bprintf b "bool try_store_%s(struct SLv6_Instruction *instr, uint%d_t bincode)"
       id (if k = ARM then 32 else 16);;
@@ -185,6 +238,18 @@ module DecStoreConfig = struct
       bprintf b "  instr->args.g0.id = SLV6_%s_ID;\n" x.xprog.fid;
       bprintf b "%a" (list store) x.xips;;
   let return_action = "if (!found) instr->args.g0.id = SLV6_UNPRED_OR_UNDEF_ID;"
+  let table_tree = true;;
+  let table_main b =
+    bprintf b "%a {\n" main_prof (Thumb, "");
+    bprintf b "  instr->args = slv6_thumb_table[bincode].args;\n}\n\n";
+    bprintf b "struct SLv6_Instruction slv6_thumb_table[SLV6_THUMB_TABLE_SIZE];\n\n";
+    bprintf b "static void fill_thumb_table(void) {\n";
+    bprintf b "  uint32_t i;\n";
+    bprintf b "  for (i = 0; i<SLV6_THUMB_TABLE_SIZE; ++i)\n";
+    bprintf b "    thumb_decode_and_store_tree(&slv6_thumb_table[i],i);\n}\n\n";
+    bprintf b "void slv6_init_thumb_table(void) {\n";
+    bprintf b "  static pthread_once_t once = PTHREAD_ONCE_INIT;\n";
+    bprintf b "  pthread_once(&once,fill_thumb_table);\n}\n";;
 end;;
 module DecStore = DecoderGenerator(DecStoreConfig);;
 
@@ -229,6 +229,7 @@ type xprog = {
                                  * of computed parameters *)
   xgid: int; (* id of the group *)
   xw: int option; (* weight *)
+  xbase: int; (* position of the base instruction in the weight file *)
 }
 
 let union_id x = "g" ^ string_of_int x.xgid;;
@@ -336,7 +337,13 @@ let xprogs_of (fs: fprog list) (wf: string option) : xprog list * group list =
     with Not_found -> match !groups with
       | (n, _) :: _ -> groups := (n+1, ps) :: !groups; n+1
       | [] -> raise (Failure "error while computing group id")
+  in let base fp =
+    let rec aux n = function
+      | f :: tl -> if f == fp then n else aux (n+1) tl
+      | [] -> raise (Failure "error while computing base position")
+    in aux 0 fs
   in let xprog_of (fp, w) =
+      let b = base fp in
       let ps, ls = Gencxx.V.vars fp.finst in
       let fp1, kps, cs = computed_params fp ps in
       let fp2 = {fp1 with finst = remove_cond_passed fp1.finst} in
@@ -349,7 +356,7 @@ let xprogs_of (fs: fprog list) (wf: string option) : xprog list * group list =
           let cmp (_,t) (_,t') = compare (sizeof t) (sizeof t')
           in List.stable_sort cmp (kps' @ cs)
         in {xprog = fp; xps = ps; xls = ls; xcs = cs; xips = ips;
-            xgid = gid ips; xw = w}
+            xgid = gid ips; xw = w; xbase = b}
       in List.map aux fpkps
   in List.flatten (List.map xprog_of (get_weights fs wf)), !groups;;
 
@@ -389,6 +396,37 @@ let no_immed_variants xs =
           xips = List.remove_assoc "immed_5" x.xips}
   in List.map prog (List.filter no_immed_filter xs);;
 
-let restricted_variants xs = no_cond_variants xs @ no_immed_variants xs;;
+(* for each hot instruction setting the flags N, Z, C or V, we generate a
+ * variant that does not set them. A basic block uses this variant when
+ * the flags set by the instruction are dead (see slv6_bb_translate) *)
+
+(* name of the flag N, Z, C or V designated by e, if any *)
+let nzcv_of_exp = function
+  | Ast.Range (CPSR, Flag (("N"|"Z"|"C"|"V") as s, _)) -> Some s
+  | Ast.Range (CPSR, Index (Num ("31"|"30"|"29"|"28" as n))) ->
+      Some (String.sub (Gencxx.cpsr_flag n) 0 1)
+  | _ -> None;;
+
+(* name of the flag N, Z, C or V assigned by i, if any *)
+let assigned_nzcv = function
+  | Assign (e, _) -> nzcv_of_exp e
+  | _ -> None;;
+
+let no_flags_filter x =
+  is_hot x && inst_exists (fun i -> assigned_nzcv i <> None) ffalse ffalse x.xprog.finst;;
+
+let no_flags_variants xs =
+  let inst i = if assigned_nzcv i <> None then Norm.nop else i in
+  let prog x =
+    let f = x.xprog in
+    let f' =
+      {f with fid = f.fid^"_NF"; fref = f.fref^"--NF"; fname = f.fname^" (no flags)";
+         finst = simplify (ast_map inst (fun e -> e) f.finst)}
+    in {x with xprog = f'}
+  in List.map prog (List.filter no_flags_filter xs);;
+
+let restricted_variants xs =
+  let ncs = no_cond_variants xs in
+    ncs @ no_immed_variants xs @ no_flags_variants (xs @ ncs);;
 
 end
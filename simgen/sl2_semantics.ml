@@ -21,7 +21,8 @@ open Printf;;
 let implicit_arg = function
   | "ConditionPassed" -> "&proc->cpsr, "
   | "slv6_write_word_as_user" | "slv6_write_byte_as_user"
-  | "slv6_write_word" | "slv6_write_half" | "slv6_write_byte" -> "proc->mmu_ptr, "
+  | "slv6_write_word" | "slv6_write_half" | "slv6_write_byte"
+  | "slv6_fast_write_word" | "slv6_fast_write_half" | "slv6_fast_write_byte" -> "proc->mmu_ptr, "
   | "CP15_reg1_EEbit" | "CP15_reg1_Ubit" | "CP15_reg1_Vbit" -> "proc->cp15_ptr"
   | "set_bit" | "set_field" -> "addr_of_"
   | "InAPrivilegedMode" | "CurrentModeHasSPSR" | "address_of_next_instruction"
@@ -29,6 +30,10 @@ let implicit_arg = function
   | "get_current_mode" -> "proc"
   | "reg_m" | "set_reg_m" -> "proc, "
   | "exec_undefined_instruction" -> "proc, NULL"
+  | "ExecutingProcessor" -> "proc"
+  | "Shared" | "MarkExclusiveGlobal" | "IsExclusiveGlobal"
+  | "ClearExclusiveByAddress" -> "proc->mmu_ptr, "
+  | "MarkExclusiveLocal" | "IsExclusiveLocal" | "ClearExclusiveLocal" -> "proc, "
   | _ -> "";;
 
 let typeof x v =
@@ -37,11 +42,82 @@ let typeof x v =
     try List.assoc v x.xls
   with Not_found -> List.assoc v x.xcs;;
 
-(* Load and Store instruction with a T suffix access the memory in special way *)
+(* Load and Store instruction with a T suffix access the memory in special
+ * way. LDREX reserves the address before reading it (see arm_monitor.h) *)
 let lst (p: xprog) = match p.xprog.finstr with
   | "LDRT" | "LDRBT" | "STRT" | "STRBT" -> "_as_user"
+  | "LDREX" -> "_exclusive"
   | _ -> "";;
 
+(* name of the function accessing the memory. With option -fast-mem, we
+ * use the inline accessors (see arm_mmu.h), except for the instructions
+ * with a T suffix and LDREX *)
+let mem_fct (p: xprog) (rw: string) n =
+  let prefix = if get_fast_mem() && lst p = "" then "slv6_fast_" else "slv6_" in
+    prefix ^ rw ^ "_" ^ Gencxx.access_type n ^ lst p;;
+
+(* With option -packed-cpsr, the flags N, Z, C and V are stored in the
+ * field nzcv of SLv6_StatusRegister, and accessed through the functions
+ * of slv6_status_register.h. nzcv_flag returns the name of the flag if
+ * e is one of them. *)
+let nzcv_flag e =
+  if get_packed_cpsr () then nzcv_of_exp e else None;;
+
+(* A sequence of assignments to the flags N, Z, C and V is replaced by a
+ * single call to set_NZCV_bits, whose arguments are the flag names and
+ * the values. The assignments are grouped only if the values do not
+ * read the CPSR, so that they can be computed before any flag is set
+ * (e.g., V Flag is not grouped with C Flag in ADC) *)
+let group_flags (is: inst list) =
+  let reads_cpsr =
+    exp_exists (function
+                  | CPSR | Ast.Range (CPSR, _) | Fun ("ConditionPassed", _) -> true
+                  | _ -> false) ffalse in
+  let flush = function
+    | [] -> []
+    | [_, _, i] -> [i]
+    | run ->
+        let args = List.fold_left (fun l (f, e, _) -> Var f :: e :: l) [] run in
+          [Proc ("set_NZCV_bits", args)]
+  in
+  let rec aux run = function
+    | Assign (dst, src) as i :: is ->
+        (match nzcv_flag dst with
+           | Some f when run = [] -> aux [f, src, i] is
+           | Some f when not (reads_cpsr src)
+                 && not (List.exists (fun (f', _, _) -> f = f') run) ->
+               aux ((f, src, i) :: run) is
+           | Some f -> flush run @ aux [f, src, i] is
+           | None -> flush run @ i :: aux [] is)
+    | i :: is -> flush run @ i :: aux [] is
+    | [] -> flush run
+  in aux [] is;;
+
+(* With option -lazy-flags, a group of flag assignments (see group_flags)
+ * is replaced by a call to set_lazy_flags if it has one of the following
+ * forms, where r, a and b are any expressions:
+ * - N = r[31], Z = (r==0), C = CarryFrom(a+b), V = OverflowFrom(a+b)
+ * - N = r[31], Z = (r==0), C = NOT BorrowFrom(a-b), V = OverflowFrom(a-b)
+ * - N = r[31], Z = (r==0), C = c
+ * lazy_flags returns the operation and the arguments of set_lazy_flags *)
+let lazy_flags (fes: (string * exp) list) =
+  let assoc f = try Some (List.assoc f fes) with Not_found -> None in
+    if not (get_lazy_flags ()) then None
+    else match assoc "N", assoc "Z", assoc "C", assoc "V" with
+      | Some (Ast.Range (r, Index (Num "31"))),
+        Some (If_exp (BinOp (r', "==", Num "0"), Num "1", Num "0")
+             | BinOp (r', "==", Num "0")), Some c, v when r = r' -> (
+          match c, v with
+            | Fun ("CarryFrom_add2", [a; b]),
+              Some (Fun ("OverflowFrom_add2", [a'; b'])) when a = a' && b = b' ->
+                Some ("SLV6_LAZY_ADD", [r; a; b])
+            | Fun (("not"|"NOT"), [Fun ("BorrowFrom_sub2", [a; b])]),
+              Some (Fun ("OverflowFrom_sub2", [a'; b'])) when a = a' && b = b' ->
+                Some ("SLV6_LAZY_SUB", [r; a; b])
+            | _, None -> Some ("SLV6_LAZY_LOGIC", [r; c; Num "0"])
+            | _ -> None)
+      | _ -> None;;
+
 let inst_size (p: xprog) =
   let pi = function
     | Assign (Ast.Range (CPSR, Flag ("T", _)), _)
@@ -143,7 +219,11 @@ let rec exp (p: xprog) b =
         to_iu64 b string s
       else string b s 
   | Memory (e, n) ->
-      bprintf b "slv6_read_%s%s(proc->mmu_ptr,%a)" (Gencxx.access_type n) (lst p) (exp p) e
+      bprintf b "%s(proc->mmu_ptr,%a)" (mem_fct p "read" n) (exp p) e
+  | Ast.Range (CPSR, _) as e when nzcv_flag e <> None ->
+      (match nzcv_flag e with
+         | Some f -> bprintf b "get_%s_flag(&proc->cpsr)" f
+         | None -> assert false)
   | Ast.Range (CPSR, Flag (s,_)) -> bprintf b "proc->cpsr.%s_flag" s
   | Ast.Range (CPSR, Index (Num s)) -> bprintf b "proc->cpsr.%s" (Gencxx.cpsr_flag s)
   | Ast.Range (e1, Index e2) -> bprintf b "get_bit(%a,%a)" (exp p) e1 (exp p) e2
@@ -192,6 +272,18 @@ and inst_aux p k b = function
       bprintf b "if (!slv6_%s_%s(proc,addr_of_reg(proc,%a),%a)) return"
         p.xprog.finstr s (exp p) r (list_sep "," (exp p)) (e::es)
   | Assign (dst, src) -> affect p k b dst src
+  | Proc ("set_NZCV_bits", args) ->
+      let rec pairs = function
+        | Var f :: e :: l -> (f, e) :: pairs l
+        | _ -> [] in
+      let fes = pairs args in (
+        match lazy_flags fes with
+          | Some (op, es) ->
+              bprintf b "set_lazy_flags(&proc->cpsr, %s, %a)" op (list_sep ", " (exp p)) es
+          | None ->
+              bprintf b "set_NZCV_bits(&proc->cpsr, %a,\n%a  %a)"
+                (list_sep "|" (fun b (f, _) -> bprintf b "SLV6_%s_BIT" f)) fes indent k
+                (list_sep "|" (fun b (f, e) -> bprintf b "(%a ? SLV6_%s_BIT : 0)" (exp p) e f)) fes)
   | Proc ("ClearExclusiveByAddress" as f, es) ->
       bprintf b "%s%d(%s%a)"
         f (List.length es) (implicit_arg f) (list_sep ", " (exp p)) es
@@ -199,6 +291,8 @@ and inst_aux p k b = function
       bprintf b "%s(%s%a)" f (implicit_arg f) (list_sep ", " (exp p)) es
   | Assert e -> bprintf b "assert(%a)" (exp p) e
 
+  | Block is when get_packed_cpsr () && group_flags is <> is ->
+      inst_aux p k b (Block (group_flags is))
   | Block [] -> ()
   | Block (Block _ | For _ | While _ | If _ | Case _ as i :: is) ->
       bprintf b "%a\n%a" (inst_aux p k) i (list_sep "\n" (inst p k)) is
@@ -282,6 +376,10 @@ and affect (p: xprog) k b dst src =
     | Var ("value" as v) when p.xprog.fid.[0] = 'S' || p.xprog.fid = "UMAAL" -> 
       bprintf64 b (fun b -> bprintf b "%a = " (exp p) (Var v)) (fun b -> exp p b src) (fun _ -> ())
     | Var v -> bprintf b "%a = %a" (exp p) (Var v) (exp p) src
+    | Ast.Range (CPSR, _) when nzcv_flag dst <> None ->
+        (match nzcv_flag dst with
+           | Some f -> bprintf b "set_%s_flag(&proc->cpsr,%a)" f (exp p) src
+           | None -> assert false)
     | Ast.Range (CPSR, Flag (s,_)) ->
         bprintf b "proc->cpsr.%s_flag = %a" s (exp p) src
     | Ast.Range (CPSR, Index (Num ("6"|"7"|"8" as n))) ->
@@ -297,7 +395,7 @@ and affect (p: xprog) k b dst src =
     | Ast.Range (e1, Bits (n1, n2)) ->
         inst_aux p k b (Proc ("set_field", [e1; Num n1; Num n2; src]))
     | Memory (addr, n) ->
-        inst_aux p k b (Proc ("slv6_write_" ^ Gencxx.access_type n ^ lst p, [addr; src]))
+        inst_aux p k b (Proc (mem_fct p "write" n, [addr; src]))
     | Ast.Range (e, Index n) -> inst_aux p k b (Proc ("set_bit", [e; n; src]))
     | _ -> string b "TODO(\"affect\")";;
 
@@ -325,12 +423,13 @@ let prog_expanded b (p: xprog) =
       (inst p 2) p.xprog.finst;;
 
 (* Version 2: The arguments are passed in a struct *)
-let prog_grouped b (p: xprog) =
+(* - prefix: the beginning of the function profile, up to the instruction id *)
+let prog_grouped_with (prefix: string) b (p: xprog) =
   let ss = List.fold_left (fun l (s, _) -> s::l) [] p.xps in
   let inregs = List.filter (fun x -> List.mem x Gencxx.input_registers) ss in
     bprintf b
-      "%avoid slv6_G_%s(struct SLv6_Processor *proc, struct SLv6_Instruction *instr) {\n"
-      comment p p.xprog.fid;
+      "%a%s%s(struct SLv6_Processor *proc, struct SLv6_Instruction *instr) {\n"
+      comment p prefix p.xprog.fid;
     let expand b (n, t) =
       bprintf b "  const %s %s = instr->args.%s.%s;\n" t n (union_id p) n
     in
@@ -341,6 +440,12 @@ let prog_grouped b (p: xprog) =
         (list Gencxx.local_decl) p.xls
         (inst p 2) p.xprog.finst;;
 
+let prog_grouped = prog_grouped_with "void slv6_G_";;
+
+(* Version 3: same as version 2, but the function is inlined in the
+ * direct-threaded interpreter *)
+let prog_threaded = prog_grouped_with "static inline void slv6_T_";;
+
 (* Declaration of the functions. This may be printed in a header file (.h) *)
 (* Version 1: The list of arguemetns is expanded *)
 let decl_expanded b x =
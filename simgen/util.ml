@@ -43,6 +43,23 @@ let is_set_get_set m init =
 let get_verbose, set_verbose = get_set_bool();;
 let get_debug, set_debug = get_set_bool();;
 
+(* if set, the simlight2 semantics functions use the inline memory
+ * accessors (simgen option -fast-mem) *)
+let get_fast_mem, set_fast_mem = get_set_bool();;
+
+(* if set, the flags N, Z, C and V of the simlight2 status registers are
+ * packed in one word (simgen option -packed-cpsr) *)
+let get_packed_cpsr, set_packed_cpsr = get_set_bool();;
+
+(* if set, the flags set by additions, subtractions and logical operations
+ * are computed only when they are read (simgen option -lazy-flags,
+ * which implies -packed-cpsr) *)
+let get_lazy_flags, set_lazy_flags = get_set_bool();;
+
+(* if set, the simlight2 Thumb decoders use a table of the 65536 decoded
+ * Thumb instructions (simgen option -thumb-table) *)
+let get_thumb_table, set_thumb_table = get_set_bool();;
+
 let fverbose fmt f x = if get_verbose() then eprintf fmt f x else ();;
 
 let verbose x = if get_verbose() then eprintf "%s" x else ();;